@@ -0,0 +1,102 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "Triangle.h"
+
+namespace mndl {
+
+/** Triangle with the inverse of its barycentric basis cached.
+ *  toBarycentric and contains give the same results as TriangleT, without
+ *  computing a determinant and dividing on every call. A degenerate
+ *  triangle with a zero determinant contains no point and every point is
+ *  at its vertex c in barycentric coordinates. **/
+template< typename T >
+class BarycentricTriangleT
+{
+	public:
+		BarycentricTriangleT() { set( TriangleT< T >() ); }
+		BarycentricTriangleT( const TriangleT< T > &triangle ) { set( triangle ); }
+
+		void set( const TriangleT< T > &triangle )
+		{
+			mTriangle = triangle;
+
+			const ci::Vec2< T > &a = triangle.a();
+			const ci::Vec2< T > &b = triangle.b();
+			const ci::Vec2< T > &c = triangle.c();
+			T det = ( a.x - c.x ) * ( b.y - c.y ) - ( b.x - c.x ) * ( a.y - c.y );
+			mDegenerate = ( det == 0 );
+			if ( mDegenerate )
+			{
+				mInvBasis[ 0 ] = mInvBasis[ 1 ] = mInvBasis[ 2 ] = mInvBasis[ 3 ] = 0;
+				return;
+			}
+
+			T invDet = (T)1 / det;
+			mInvBasis[ 0 ] = invDet * ( b.y - c.y );
+			mInvBasis[ 1 ] = invDet * ( c.x - b.x );
+			mInvBasis[ 2 ] = invDet * ( c.y - a.y );
+			mInvBasis[ 3 ] = invDet * ( a.x - c.x );
+		}
+
+		const TriangleT< T > & getTriangle() const { return mTriangle; }
+		const ci::Vec2< T > & a() const { return mTriangle.a(); }
+		const ci::Vec2< T > & b() const { return mTriangle.b(); }
+		const ci::Vec2< T > & c() const { return mTriangle.c(); }
+		const ci::RectT< T > calcBoundingBox() const { return mTriangle.calcBoundingBox(); }
+		bool isDegenerate() const { return mDegenerate; }
+
+		/** Returns the rows of the inverse basis, the barycentric coordinates are
+		 *  l1 = inv[ 0 ] * ( x - c.x ) + inv[ 1 ] * ( y - c.y ) and
+		 *  l2 = inv[ 2 ] * ( x - c.x ) + inv[ 3 ] * ( y - c.y ). **/
+		const T * getInvBasis() const { return mInvBasis; }
+
+		ci::Vec3< T > toBarycentric( const ci::Vec2< T > &p ) const
+		{
+			T dx = p.x - mTriangle.c().x;
+			T dy = p.y - mTriangle.c().y;
+			T l1 = mInvBasis[ 0 ] * dx + mInvBasis[ 1 ] * dy;
+			T l2 = mInvBasis[ 2 ] * dx + mInvBasis[ 3 ] * dy;
+			return ci::Vec3< T >( l1, l2, 1 - l1 - l2 );
+		}
+
+		ci::Vec2< T > fromBarycentric( const ci::Vec3< T > &p ) const { return mTriangle.fromBarycentric( p ); }
+
+		bool contains( const ci::Vec2< T > &p ) const
+		{
+			ci::Vec3< T > bary = toBarycentric( p );
+			return !mDegenerate && ( 0 <= bary.x ) && ( 0 <= bary.y ) &&
+				   ( bary.x + bary.y <= 1 );
+		}
+
+		T distanceSquared( const ci::Vec2< T > &p ) const { return mTriangle.distanceSquared( p ); }
+
+	private:
+		TriangleT< T > mTriangle;
+		T mInvBasis[ 4 ]; //< rows of the inverse of the basis ( a - c, b - c ), 0 if degenerate
+		bool mDegenerate;
+};
+
+typedef BarycentricTriangleT< float > BarycentricTrianglef;
+typedef BarycentricTriangleT< double > BarycentricTriangled;
+
+} // namespace mndl
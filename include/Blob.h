@@ -25,40 +25,100 @@ namespace mndl {
 
 struct Blob
 {
-	Blob() : mId( -1 ) {}
+	Blob() : mId( -1 ), mArea( 0.f ) {}
 
 	int32_t mId;
 	ci::Rectf mBbox;
 	ci::Vec2f mCentroid;
 	ci::Vec2f mPrevCentroid;
+	float mArea; //< contour area normalized to the image area, 0 for TUIO and shared memory blobs
 };
-typedef std::shared_ptr< Blob > BlobRef;
 
 //! Represents a blob event
 class BlobEvent
 {
 	public:
-		BlobEvent( BlobRef blobRef ) : mBlobRef( blobRef ) {}
+		enum Type
+		{
+			BLOB_BEGAN = 0,
+			BLOB_MOVED,
+			BLOB_ENDED
+		};
+
+		BlobEvent( const Blob &blob, Type type, double time = 0. ) :
+			mBlob( blob ), mType( type ), mTime( time ) {}
+
+		//! Returns the type of the event
+		Type getType() const { return mType; }
+		//! Returns the time of the camera frame the event was detected in, in seconds
+		double getTime() const { return mTime; }
 
 		//! Returns an ID unique for the lifetime of the blob
-		int32_t getId() const { return mBlobRef->mId; }
+		int32_t getId() const { return mBlob.mId; }
 		//! Returns the x position of the blob centroid normalized to the image source width
-		float getX() const { return mBlobRef->mCentroid.x; }
+		float getX() const { return mBlob.mCentroid.x; }
 		//! Returns the y position of the blob centroid normalized to the image source height
-		float getY() const { return mBlobRef->mCentroid.y; }
+		float getY() const { return mBlob.mCentroid.y; }
 		//! Returns the position of the blob centroid normalized to the image resolution
-		ci::Vec2f getPos() const { return mBlobRef->mCentroid; }
+		ci::Vec2f getPos() const { return mBlob.mCentroid; }
 		//! Returns the previous x position of the blob centroid normalized to the image source width
-		float getPrevX() const { return mBlobRef->mPrevCentroid.x; }
+		float getPrevX() const { return mBlob.mPrevCentroid.x; }
 		//! Returns the previous y position of the blob centroid normalized to the image source height
-		float getPrevY() const { return mBlobRef->mPrevCentroid.y; }
+		float getPrevY() const { return mBlob.mPrevCentroid.y; }
 		//! Returns the previous position of the blob centroid normalized to the image resolution
-		ci::Vec2f getPrevPos() const { return mBlobRef->mPrevCentroid; }
+		ci::Vec2f getPrevPos() const { return mBlob.mPrevCentroid; }
 
 		//! Returns the bounding box of the blob
-		ci::Rectf & getBoundingBox() const { return mBlobRef->mBbox; }
+		const ci::Rectf & getBoundingBox() const { return mBlob.mBbox; }
+	private:
+		Blob mBlob;
+		Type mType;
+		double mTime;
+};
+
+//! Contiguous range of blob events
+class BlobEventRange
+{
+	public:
+		typedef const BlobEvent * const_iterator;
+
+		BlobEventRange() : mBegin( NULL ), mEnd( NULL ) {}
+		BlobEventRange( const BlobEvent *begin, const BlobEvent *end ) :
+			mBegin( begin ), mEnd( end ) {}
+
+		const_iterator begin() const { return mBegin; }
+		const_iterator end() const { return mEnd; }
+		size_t size() const { return mEnd - mBegin; }
+		bool empty() const { return mBegin == mEnd; }
+		const BlobEvent & operator[]( size_t i ) const { return mBegin[ i ]; }
+
+	private:
+		const BlobEvent *mBegin;
+		const BlobEvent *mEnd;
+};
+
+//! Represents all blob events of a frame sorted by type, began events first, then moved and ended events
+class BlobFrameEvent
+{
+	public:
+		BlobFrameEvent( const BlobEvent *events, size_t numBegan, size_t numMoved, size_t numEnded ) :
+			mEvents( events ), mNumBegan( numBegan ), mNumMoved( numMoved ), mNumEnded( numEnded )
+		{}
+
+		//! Returns all events of the frame
+		BlobEventRange getEvents() const { return BlobEventRange( mEvents, mEvents + mNumBegan + mNumMoved + mNumEnded ); }
+		//! Returns the events of the blobs that appeared in the frame
+		BlobEventRange getBegan() const { return BlobEventRange( mEvents, mEvents + mNumBegan ); }
+		//! Returns the events of the blobs that moved in the frame
+		BlobEventRange getMoved() const { return BlobEventRange( mEvents + mNumBegan, mEvents + mNumBegan + mNumMoved ); }
+		//! Returns the events of the blobs that ended in the frame
+		BlobEventRange getEnded() const { return BlobEventRange( mEvents + mNumBegan + mNumMoved, mEvents + mNumBegan + mNumMoved + mNumEnded ); }
+
 	private:
-		BlobRef mBlobRef;
+		const BlobEvent *mEvents;
+		size_t mNumBegan;
+		size_t mNumMoved;
+		size_t mNumEnded;
 };
 
 } // namespace mndl
@@ -0,0 +1,113 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+
+#include "Blob.h"
+#include "TrackTable.h"
+
+namespace mndl {
+
+/** Passes the tracked blobs from a detection process to a rendering process.
+ *  Frames are stored in a ring of fixed-size slots in POSIX shared memory,
+ *  each slot protected by a sequence lock. The writer never waits for the
+ *  reader, a reader falling behind by more than the ring size skips the
+ *  overwritten frames. Writing and reading only touch the mapped memory,
+ *  system calls are limited to opening and closing the channel. The
+ *  transport benchmark of the tracker checks the latency to a continuously
+ *  polling reader against the 50 us requirement, in the tracker the
+ *  latency is dominated by the reader polling once per update().
+ *  Not available on Windows, open() fails there. **/
+class BlobChannel
+{
+	public:
+		//! Maximum number of blobs in a frame, the rest is dropped
+		static const size_t MAX_BLOBS = 64;
+		//! Number of frames in the ring
+		static const size_t NUM_SLOTS = 16;
+
+		BlobChannel();
+		~BlobChannel();
+
+		/** Creates or opens the shared memory object \a name for writing.
+		 *  Returns false on error. **/
+		bool openWriter( const std::string &name );
+		/** Opens the existing shared memory object \a name for reading.
+		 *  Returns false if the writer has not created it yet. **/
+		bool openReader( const std::string &name );
+		void close();
+
+		bool isOpen() const { return mShared != NULL; }
+		bool isWriter() const { return isOpen() && mWriter; }
+		const std::string & getName() const { return mName; }
+
+		//! Publishes the tracks of a frame.
+		void write( const TrackTable &tracks, double time );
+
+		/** Reads the next unread frame into \a blobs and \a time.
+		 *  Returns false if there is no new frame. **/
+		bool read( std::vector< Blob > *blobs, double *time );
+
+		//! Returns the number of frames the reader skipped because the writer overwrote them
+		uint32_t getDroppedFrames() const { return mDroppedFrames; }
+
+	private:
+		// no copies of the mapping
+		BlobChannel( const BlobChannel & );
+		BlobChannel & operator=( const BlobChannel & );
+
+		bool open( const std::string &name, bool writer );
+
+		struct SharedBlob
+		{
+			int32_t mId;
+			float mCentroid[ 2 ];
+			float mBbox[ 4 ];
+		};
+
+		struct Slot
+		{
+			volatile uint32_t mSequence; //< odd while the slot is written
+			uint32_t mIndex; //< index of the frame in the slot
+			uint32_t mNumBlobs;
+			double mTime;
+			SharedBlob mBlobs[ MAX_BLOBS ];
+		};
+
+		struct Shared
+		{
+			uint32_t mMagic;
+			uint32_t mSize;
+			volatile uint32_t mWriteIndex; //< number of frames published
+			Slot mSlots[ NUM_SLOTS ];
+		};
+
+		bool readSlot( uint32_t index, std::vector< Blob > *blobs, double *time ) const;
+
+		Shared *mShared;
+		std::string mName;
+		bool mWriter;
+		uint32_t mReadIndex; //< index of the next frame to read, wraps with the write index
+		uint32_t mDroppedFrames;
+};
+
+} // namespace mndl
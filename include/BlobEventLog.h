@@ -0,0 +1,83 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Vector.h"
+
+#include "Blob.h"
+
+namespace mndl {
+
+/** Recorded stream of blob events.
+ *  The text format has a header line followed by one event per line:
+ *  frame number, type (b, m or e), blob id and normalized position. **/
+class BlobEventLog
+{
+	public:
+		struct Entry
+		{
+			uint32_t mFrame;
+			BlobEvent::Type mType;
+			int32_t mId;
+			ci::Vec2f mPos;
+		};
+
+		struct Diff
+		{
+			Diff() : mFrames( 0 ), mEvents( 0 ), mGoldenEvents( 0 ),
+				mMissing( 0 ), mExtra( 0 ), mMoved( 0 ), mMaxError( 0.f ) {}
+
+			bool passed() const { return ( mMissing == 0 ) && ( mExtra == 0 ) && ( mMoved == 0 ); }
+
+			uint32_t mFrames;
+			size_t mEvents;
+			size_t mGoldenEvents;
+			size_t mMissing; //< golden events not found in the log
+			size_t mExtra; //< log events not found in the golden log
+			size_t mMoved; //< matching events with position error above tolerance
+			float mMaxError; //< maximum position error of the matching events
+			std::vector< std::string > mMessages; //< description of the first differences
+		};
+
+		void clear() { mEntries.clear(); }
+		//! Appends the events of \a event as frame \a frame.
+		void add( uint32_t frame, const BlobFrameEvent &event );
+
+		const std::vector< Entry > & getEntries() const { return mEntries; }
+
+		//! Writes the log to \a path. Returns false if the file could not be written.
+		bool write( const ci::fs::path &path ) const;
+		//! Loads the log from \a path. Returns false if the file could not be read.
+		bool load( const ci::fs::path &path );
+
+		/** Compares the log against \a golden. Blob ids are matched by their
+		 *  began events, so logs recorded with different id counters compare
+		 *  equal. Events of a frame match regardless of their order. **/
+		Diff compare( const BlobEventLog &golden, float tolerance ) const;
+
+	private:
+		std::vector< Entry > mEntries;
+};
+
+} // namespace mndl
@@ -28,26 +28,29 @@
 #include "cinder/qtime/MovieWriter.h"
 #include "cinder/qtime/QuickTime.h"
 
+#include "cinder/Channel.h"
 #include "cinder/Function.h"
 #include "cinder/Rect.h"
+#include "cinder/Thread.h"
 #include "cinder/Vector.h"
 
 #include "Blob.h"
+#include "BlobChannel.h"
 #include "CaptureParams.h"
 #include "ManualCalibration.h"
 #include "PParams.h"
+#include "TrackTable.h"
+#include "Tuio.h"
 
 namespace mndl {
 
 class BlobTracker
 {
 	public:
-		BlobTracker() :
-			mSavingVideo( false ),
-			mIdCounter( 1 )
-		{}
+		BlobTracker();
 
-		void setup();
+		//! Sets up the capture and the calibration mapping into \a calibrationRect.
+		void setup( const ci::Rectf &calibrationRect = ci::Rectf( 0.f, 0.f, 1.f, 1.f ) );
 		void update();
 		void draw();
 		void shutdown();
@@ -55,6 +58,16 @@ class BlobTracker
 		typedef void( BlobCallback )( BlobEvent );
 		typedef boost::signals2::signal< BlobCallback > BlobSignal;
 
+		typedef void( BlobFrameCallback )( const BlobFrameEvent & );
+		typedef boost::signals2::signal< BlobFrameCallback > BlobFrameSignal;
+
+		//! Registers a callback receiving all blob events of a frame in one call
+		template< typename T >
+		boost::signals2::connection registerBlobsFrame( void( T::*fn )( const BlobFrameEvent & ), T *obj )
+		{
+			return mBlobsFrameSig.connect( std::function< BlobFrameCallback >( boost::bind( fn, obj, ::_1 ) ) );
+		}
+
 		template< typename T >
 		boost::signals2::connection registerBlobsBegan( void( T::*fn )( BlobEvent ), T *obj )
 		{
@@ -89,6 +102,8 @@ class BlobTracker
 		size_t getBlobNum() const;
 		ci::Rectf getBlobBoundingRect( size_t i ) const;
 		ci::Vec2f getBlobCentroid( size_t i ) const;
+		int32_t getBlobId( size_t i ) const;
+		bool isBlobCoasting( size_t i ) const;
 
 		std::shared_ptr< ManualCalibration > getCalibrator() const
 		{
@@ -96,14 +111,26 @@ class BlobTracker
 		}
 
 	private:
+		friend class SessionReplay;
+		friend class TrackerBenchmark;
+
 		enum {
 			SOURCE_RECORDING = 0,
-			SOURCE_CAMERA
+			SOURCE_CAMERA,
+			SOURCE_TUIO,
+			SOURCE_SHARED_MEMORY
 		};
 
 		void setupGui();
 		void playVideoCB();
 		void saveVideoCB();
+		void benchmarkCB();
+		void transportBenchmarkCB();
+		//! Replays the sessions of a folder, \a record writes their golden logs.
+		void replaySessionsCB( bool record );
+
+		//! Copies the detection and tracking parameters of \a config.
+		void copyTrackingSettings( const BlobTracker &config );
 
 		// capture
 		mndl::CaptureParams mCapture;
@@ -117,8 +144,11 @@ class BlobTracker
 		ci::qtime::MovieSurface mMovie;
 		ci::qtime::MovieWriter mMovieWriter;
 		bool mSavingVideo;
+		//! camera frames of the tracking thread, added to the movie in update()
+		std::vector< ci::Surface8u > mSavedFrames;
+		std::vector< ci::Surface8u > mDrainedSavedFrames;
 
-		int mSource; // recording or camera
+		int mSource; // recording, camera, tuio or shared memory
 
 		static const int CAPTURE_WIDTH = 640;
 		static const int CAPTURE_HEIGHT = 480;
@@ -139,17 +169,126 @@ class BlobTracker
 		float mMinArea;
 		float mMaxArea;
 
-		std::vector< BlobRef > mBlobs;
-		void trackBlobs( std::vector< BlobRef > newBlobs );
-		int32_t findClosestBlobKnn( const std::vector< BlobRef > &newBlobs,
-				BlobRef track, int k, double thresh );
+		float mReplayTolerance; //< maximum position difference to the golden event log
+
+		//! Detection parameters of a frame, copied for the tracking thread
+		struct DetectionSettings
+		{
+			bool mFlip;
+			int mThreshold;
+			int mBlurSize;
+			float mMinArea;
+			float mMaxArea;
+			int mDrawCapture;
+			ci::RectMapping mNormMapping;
+		};
+		DetectionSettings getDetectionSettings() const;
+		void detectBlobs( const ci::Surface8u &inputSurface, const DetectionSettings &settings, double now );
+
+		TrackTable mTracks; //< owned by the tracking thread while it is running
+		TrackTable mPublishedTracks; //< tracks of the last frame of the tracking thread
+		TrackTable mDrainedTracks; //< tracks seen by the main thread while the tracking thread is running
+		//! Returns the tracks of the last frame delivered on the main thread.
+		const TrackTable & getTracks() const { return mQueueEvents ? mDrainedTracks : mTracks; }
+		std::vector< Blob > mNewBlobs; //< blobs detected in the current frame, reused between frames
+		std::vector< int32_t > mBlobOwners; //< index of the track claiming the new blob or -1
+		std::vector< float > mBlobOwnerAreas; //< total area of the tracks claiming the new blob
+		std::vector< int32_t > mBlobShares; //< number of tracks sharing the new blob
+		std::vector< int32_t > mTrackWinners; //< index of the new blob matched with the track or -1
+		void trackBlobs( const std::vector< Blob > &newBlobs, double now );
+		int32_t findClosestBlob( const std::vector< Blob > &newBlobs,
+				const ci::Vec2f &pos, bool unclaimedOnly ) const;
+		bool isMerge( float blobArea, float ownerArea, float trackArea ) const;
+		void mirrorBlobs( const std::vector< Blob > &blobs, double now );
 		int32_t mIdCounter;
 
+		// coasting, lost blobs are kept alive for a grace period before ending
+		int mCoastFrames; //< maximum number of frames a lost blob is kept
+		int mCoastMs; //< maximum time in milliseconds a lost blob is kept
+		float mCoastDistance; //< maximum normalized distance for reconnecting a lost blob
+		int32_t mReconnectionCount; //< number of lost blobs reconnected
+		int32_t mCoastExpiredCount; //< number of lost blobs ended after the grace period
+
+		// merging, touching pens detected as one blob share it
+		float mMergeTolerance; //< maximum relative difference of the merged blob area and the sum of the track areas
+		int32_t mMergeCount; //< number of tracks merged
+		int32_t mSplitCount; //< number of merged tracks separated again
+
+		// events of the current frame, delivered in one batch at the end of the frame
+		std::vector< BlobEvent > mBeganEvents;
+		std::vector< BlobEvent > mMovedEvents;
+		std::vector< BlobEvent > mEndedEvents;
+		std::vector< BlobEvent > mFrameEvents;
+		void dispatchEvents( double now );
+		void sendEvents( const BlobFrameEvent &event, double now );
+		void queueEvents();
+		void fireEvents( const BlobFrameEvent &event );
+
 		// signals
+		BlobFrameSignal mBlobsFrameSig;
 		BlobSignal mBlobsBeganSig;
 		BlobSignal mBlobsMovedSig;
 		BlobSignal mBlobsEndedSig;
 
+		// tuio
+		TuioSender mTuioSender;
+		TuioReceiver mTuioReceiver;
+		bool mTuioOutput;
+		std::string mTuioHost;
+		int mTuioPort;
+		int mTuioVersion;
+
+		// shared memory channel between the detection and the rendering process
+		BlobChannel mBlobChannel;
+		bool mChannelOutput;
+		std::string mChannelName;
+		double mChannelOpenTime; //< time of the last open attempt
+		int32_t mChannelDroppedFrames;
+		void updateBlobChannel();
+
+		// camera rate tracking in a separate thread
+		bool mThreadedTracking;
+		volatile bool mTrackingThreadRunning;
+		bool mQueueEvents; //< events are queued for the main thread instead of fired
+		float mTrackingFps;
+		std::shared_ptr< std::thread > mTrackingThread;
+		/** Guards the capture, the settings and the outputs used by the
+		 *  tracking thread and the queues of its results. Detection and
+		 *  tracking run unlocked. **/
+		std::mutex mTrackingMutex;
+		DetectionSettings mDetectionSettings; //< settings for the tracking thread, updated in update()
+		void startTrackingThread();
+		void stopTrackingThread();
+		void trackingThread();
+
+		// debug images of the last frame, uploaded to the textures in update()
+		struct DebugChannels
+		{
+			DebugChannels() : mUpdated( false ) {}
+
+			ci::Channel8u mOrig;
+			ci::Channel8u mBlurred;
+			ci::Channel8u mThresholded;
+			bool mUpdated;
+		};
+		DebugChannels mDebugChannels; //< written by the detection
+		DebugChannels mQueuedDebugChannels; //< of the tracking thread waiting for update()
+
+		// frame events of the tracking thread waiting for the main thread,
+		// the storage is reused between frames
+		struct QueuedFrame
+		{
+			std::vector< BlobEvent > mEvents;
+			size_t mNumBegan;
+			size_t mNumMoved;
+			size_t mNumEnded;
+		};
+		std::vector< QueuedFrame > mQueuedFrames;
+		size_t mNumQueuedFrames;
+		std::vector< QueuedFrame > mDrainedFrames;
+		size_t mNumDrainedFrames;
+		void fireQueuedEvents();
+
 		std::shared_ptr< ManualCalibration > mCalibratorRef;
 
 		// normalizes blob coordinates from camera 2d coords to [0, 1]
@@ -0,0 +1,95 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include "BarycentricTriangle.h"
+
+namespace mndl {
+
+class ManualCalibration;
+
+/** Measures the point mapping methods of ManualCalibration on generated
+ *  pen positions and compares their results with the exact mapping.
+ *  Also measures and checks the triangle queries the mapping is built on. **/
+class CalibrationBenchmark
+{
+	public:
+		struct Result
+		{
+			std::string mMethod;
+			size_t mPoints;
+			double mNsPerPoint;
+			float mMaxError; //< maximum distance from the exact mapping
+			size_t mMismatches; //< points mapped differently than by ManualCalibration::map
+			size_t mFailures; //< points in the calibration grid further than the tolerance from the exact mapping
+		};
+
+		struct TriangleResult
+		{
+			std::string mMethod;
+			size_t mQueries;
+			double mNsPerQuery;
+			double mMaxError; //< maximum difference from the brute force reference
+			size_t mFailures; //< queries violating the expected properties
+		};
+
+		/** Maps \a frames frames of generated blob positions and bounding boxes with each method.
+		 *  The lookup table mappings fail on points of the calibration grid further
+		 *  than 1/1000 of the output size from the exact mapping. **/
+		static std::vector< Result > run( ManualCalibration &calibration, size_t frames = 20000 );
+		static void print( const std::vector< Result > &results, std::ostream &out );
+
+		/** Measures the point-triangle queries of TriangleT on random triangles
+		 *  and points, and checks them against brute force references. **/
+		static std::vector< TriangleResult > runTriangles( size_t queries = 200000 );
+		static void print( const std::vector< TriangleResult > &results, std::ostream &out );
+
+		/** Tests \a points random points against \a triangles random triangles
+		 *  looping over TriangleT and with TriangleBatch. The queries of the
+		 *  results are point-triangle pairs. **/
+		static std::vector< TriangleResult > runTriangleBatch( size_t triangles = 256, size_t points = 2000 );
+
+	private:
+		//! Returns the points of the frames, \a pointsPerFrame each.
+		static std::vector< ci::Vec2f > generatePoints( size_t frames, size_t *pointsPerFrame );
+		//! Squared distance of \a p from the closest edge of \a triangle or 0 if \a p is inside.
+		static double referenceDistanceSquared( const Triangled &triangle, const ci::Vec2d &p );
+
+		//! Compares \a bary with the barycentric coordinates computed in double precision.
+		static void compareBarycentric( const std::vector< Trianglef > &triangles,
+				const std::vector< ci::Vec2f > &points, const std::vector< ci::Vec3f > &bary,
+				TriangleResult *result );
+		//! Compares the distances of the triangle queries with the squared \a reference distances.
+		static void compareDistances( const std::vector< float > &distances, const std::vector< double > &reference,
+				TriangleResult *result );
+		/** Compares \a mapped with the \a exact and \a reference mapping. Points
+		 *  marked in \a checked further than \a tolerance from the exact mapping
+		 *  are failures, none if \a checked is NULL. **/
+		static void compare( const std::vector< ci::Vec2f > &mapped, const std::vector< ci::Vec2f > &exact,
+				const std::vector< ci::Vec2f > &reference, const std::vector< uint8_t > *checked,
+				float tolerance, Result *result );
+};
+
+} // namespace mndl
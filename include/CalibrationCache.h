@@ -0,0 +1,83 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+namespace mndl {
+
+/** Binary cache of the structures ManualCalibration derives from its
+ *  calibration file. The cache is keyed by the hash of the calibration
+ *  file, so it is ignored once the file changes. The file is a versioned
+ *  header followed by the camera grid, the triangle coefficients and the
+ *  lookup table as raw float arrays, read through a memory mapping. **/
+class CalibrationCache
+{
+	public:
+		struct Data
+		{
+			ci::Vec2i mGridSize;
+			int32_t mModel;
+			int32_t mLutResolution;
+			float mHomographyThreshold;
+			ci::Rectf mOutputRect;
+			float mLutMaxError;
+			std::vector< ci::Vec2f > mCameraGrid; //< gridSize.x * gridSize.y points
+			std::vector< float > mTriangleCoefficients; //< six per triangle
+			std::vector< ci::Vec2f > mLut; //< ( lutResolution + 1 )^2 points
+		};
+
+		//! Returns the 64-bit FNV-1a hash of the file at \a path, 0 if it cannot be read.
+		static uint64_t hashFile( const ci::fs::path &path );
+
+		/** Reads the cache at \a path into \a data. Returns false if the file
+		 *  is missing, has another version, is inconsistent or was not built
+		 *  with \a key. **/
+		static bool read( const ci::fs::path &path, uint64_t key, Data *data );
+		//! Writes \a data to \a path with \a key. Returns false on error.
+		static bool write( const ci::fs::path &path, uint64_t key, const Data &data );
+
+	private:
+		//! Read-only memory mapping of a whole file
+		class MappedFile;
+
+		struct Header
+		{
+			uint32_t mMagic;
+			uint32_t mVersion;
+			uint64_t mKey;
+			uint32_t mHeaderSize; //< sizeof( Header ) of the writer
+			int32_t mGridWidth;
+			int32_t mGridHeight;
+			int32_t mModel;
+			int32_t mLutResolution;
+			float mHomographyThreshold;
+			float mOutputRect[ 4 ];
+			float mLutMaxError;
+			uint32_t mNumPoints;
+			uint32_t mNumCoefficients;
+			uint32_t mNumLut;
+		};
+};
+
+} // namespace mndl
@@ -0,0 +1,46 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+namespace mndl {
+
+//! Projective 2d mapping
+class Homography
+{
+	public:
+		Homography() { setIdentity(); }
+
+		void setIdentity();
+
+		/** Fits the homography mapping \a src to \a dst with the least squared
+		 *  algebraic error, at least four points are needed. Returns false and
+		 *  sets the identity if the points are degenerate. **/
+		bool fit( const std::vector< ci::Vec2f > &src, const std::vector< ci::Vec2f > &dst );
+
+		ci::Vec2f map( const ci::Vec2f &p ) const;
+
+	private:
+		double mH[ 9 ]; //< row major 3x3 matrix
+};
+
+} // namespace mndl
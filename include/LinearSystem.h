@@ -0,0 +1,31 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+namespace mndl {
+
+/** Solves the \a n x \a n linear system given as the row major augmented
+ *  matrix \a a of \a n rows and \a n + \a rhs columns, the last \a rhs
+ *  columns being the right hand sides. \a a is overwritten, \a x receives
+ *  the solutions as \a n rows of \a rhs values. Returns false if the
+ *  system is singular. **/
+bool solveLinearSystem( std::vector< double > &a, size_t n, size_t rhs, std::vector< double > *x );
+
+} // namespace mndl
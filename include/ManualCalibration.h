@@ -21,12 +21,17 @@
 
 #include "cinder/Cinder.h"
 #include "cinder/Filesystem.h"
+#include "cinder/Rect.h"
 #include "cinder/Timeline.h"
 #include "cinder/Vector.h"
 
+#include "BarycentricTriangle.h"
 #include "Blob.h"
+#include "Homography.h"
 #include "PParams.h"
+#include "ThinPlateSpline.h"
 #include "Triangle.h"
+#include "TriangleLocator.h"
 
 namespace mndl {
 
@@ -35,7 +40,9 @@ class BlobTracker;
 class ManualCalibration
 {
 	public:
-		ManualCalibration( BlobTracker *bt );
+		/** Loads the calibration and builds the mappings into \a outputRect,
+		 *  see setOutputRect(). **/
+		ManualCalibration( BlobTracker *bt, const ci::Rectf &outputRect = ci::Rectf( 0.f, 0.f, 1.f, 1.f ) );
 		~ManualCalibration();
 
 		void startCalibration();
@@ -44,45 +51,164 @@ class ManualCalibration
 		void update();
 		void draw();
 
-		void load( const ci::fs::path &fname = ci::fs::path() );
+		/** Loads the calibration from \a fname or the default calibration file.
+		 *  The derived structures are read from the binary cache next to the
+		 *  file if it was built from the same file with the current settings.
+		 *  Returns false if there is no calibration file. **/
+		bool load( const ci::fs::path &fname = ci::fs::path() );
+		//! Saves the calibration and its cache.
 		void save();
 
-		//! Returns point \a p mapped according to the calibration grid.
+		/** Returns point \a p mapped according to the calibration model.
+		 *  Points in the normalized camera image are interpolated from the
+		 *  lookup table, others are mapped exactly. **/
 		ci::Vec2f map( const ci::Vec2f &p );
+		/** Maps \a count points from \a src to \a dst, with the same results
+		 *  as map() for each point. \a src and \a dst can be the same array. **/
+		void map( const ci::Vec2f *src, ci::Vec2f *dst, size_t count );
+		//! Returns point \a p mapped by evaluating the calibration model.
+		ci::Vec2f mapExact( const ci::Vec2f &p );
+		//! Returns point \a p mapped by the triangles of the calibration grid.
+		ci::Vec2f mapTriangles( const ci::Vec2f &p );
+		/** Returns point \a p mapped by the homography of the calibration
+		 *  points, corrected by the interpolated residuals of the points. **/
+		ci::Vec2f mapHomography( const ci::Vec2f &p );
+
+		/** Returns the distances of the calibration points from their
+		 *  homography mapped camera positions in normalized coordinates. **/
+		const std::vector< float > & getHomographyResiduals() const { return mHomographyResiduals; }
 
 		bool isCalibrating() const { return mIsCalibrating; }
+		bool isVerifying() const { return mIsVerifying; }
+
+		/** Sets the rectangle the calibration grid is mapped to, points are
+		 *  mapped into normalized coordinates by default. **/
+		void setOutputRect( const ci::Rectf &rect );
+		const ci::Rectf & getOutputRect() const { return mOutputRect; }
 
 	private:
+		friend class CalibrationBenchmark;
+
 		BlobTracker *mBlobTrackerRef;
 
-		void blobsBegan( BlobEvent event );
+		void blobsFrame( const BlobFrameEvent &event );
+		void blobsBegan( const BlobEvent &event );
 		void blobsMoved( BlobEvent event );
 
 		//! Switches calibration of tracking with projection on and off
 		void toggleCalibrationCB();
+		void benchmarkCB();
+		//! Switches verification of the calibration with random targets on and off
+		void toggleVerificationCB();
 
 		bool mIsCalibrating;
 		bool mIsDebugging;
 		size_t mCalibrationGridIndex; //< current index in \a mCalibrationGrid
-		ci::Vec2i mCalibrationGridSize;
+		ci::Vec2i mCalibrationGridSize; //< grid size params, applied when a calibration starts
+		ci::Vec2i mGridSize; //< size of \a mCalibrationGrid and \a mCameraCalibrationGrid
 		std::vector< ci::Vec2f > mCalibrationGrid; //< normalized coordinates of calibration points
 		std::vector< ci::Vec2f > mCameraCalibrationGrid; //< normalized coordinates in camera image
 
-		int mLastCalibrationIndexReceived; //< last point index calibrated in \a mCalibrationGrid
+		int mLastCalibrationIndexReceived; //< last point or verification target index received
 		ci::Vec2f mCalibrationPos; //< normalized blob position
 		int32_t mCalibrationId; //< id of the calibration blob
 
+		bool mIsVerifying;
+		int mVerificationTargetNum;
+		size_t mVerificationIndex; //< current index in \a mVerificationTargets
+		std::vector< ci::Vec2f > mVerificationTargets; //< normalized coordinates of the targets
+
+		struct VerificationSample
+		{
+			ci::Vec2f mTarget; //< normalized target position
+			ci::Vec2f mMeasured; //< normalized mapped blob position
+			float mError; //< distance in output coordinates
+			double mLatency; //< mean duration of a mapping in seconds
+		};
+		std::vector< VerificationSample > mVerificationSamples;
+		std::vector< float > mVerificationCellErrors; //< mean error of the targets in each grid cell, -1 without targets
+		float mVerificationMeanError; //< in output coordinates
+		float mVerificationMaxError;
+		float mVerificationLatency; //< mean mapping duration in nanoseconds
+		bool mShowVerification; //< show the heatmap of the last verification
+		//! Computes and prints the statistics of the verification samples.
+		void reportVerification();
+		void drawVerification( const ci::RectMapping &calibMapping );
+
 		ci::TimelineRef mTimelineRef; //< timeline for blob rejection
 		ci::Anim< bool > mRejectBlobs; //< reject blobs after receiving a blob for a short time
 
 		void resetGrid();
+		//! Sets the calibration grid points and \a mGridSize according to \a mCalibrationGridSize.
+		void setupCalibrationGrid();
 
 		std::vector< Trianglef > mTriangleGrid; //< calibration points as triangles
-		std::vector< Trianglef > mCameraTriangleGrid; //< calibration points as triangles in camera image
+		std::vector< BarycentricTrianglef > mCameraTriangleGrid; //< calibration points as triangles in camera image
+		TriangleLocator mCameraLocator; //< point location in \a mCameraTriangleGrid
+
+		//! Affine mapping of a camera triangle to its calibration triangle
+		struct TriangleMapping
+		{
+			ci::Vec3f mX; //< mapped x is mX.x * x + mX.y * y + mX.z
+			ci::Vec3f mY; //< mapped y is mY.x * x + mY.y * y + mY.z
+		};
+		std::vector< TriangleMapping > mTriangleMappings; //< mappings of \a mCameraTriangleGrid
+		ci::Rectf mOutputRect; //< output of the mappings
+		//! Sets up the triangles and all mappings from the calibration grids.
 		void setupTriangleGrid();
+		//! Sets up the triangles and their locator without the mappings.
+		void setupTriangles();
+
+		enum {
+			MODEL_TRIANGLES = 0,
+			MODEL_THIN_PLATE_SPLINE
+		};
+		int mModel; //< mapping between the calibration grids
+		int mModelBuilt; //< model of \a mLut
+		ThinPlateSpline mSpline; //< camera to normalized mapping of the calibration points
+
+		Homography mHomography; //< least squares camera to normalized mapping of the calibration points
+		std::vector< ci::Vec2f > mHomographyCorrections; //< residual vectors at the calibration points
+		ci::Vec2i mHomographyGridSize; //< grid size of \a mHomographyCorrections
+		std::vector< float > mHomographyResiduals;
+		float mHomographyMaxResidual;
+		float mHomographyThreshold; //< largest residual the homography replaces the triangles with
+		float mHomographyBuiltThreshold;
+		bool mUseHomography;
+		//! Fits the homography and decides whether it is accurate enough to be used.
+		void setupHomography();
+		//! Fits the spline if the model needs it.
+		void setupSpline();
+
+		//! Maps normalized coordinates to the output rectangle.
+		ci::Vec2f toOutput( const ci::Vec2f &p ) const
+		{
+			return ci::Vec2f( mOutputRect.x1 + p.x * mOutputRect.getWidth(),
+							  mOutputRect.y1 + p.y * mOutputRect.getHeight() );
+		}
+
+		int mLutResolution; //< number of lookup table cells along each axis
+		int mLutBuiltResolution; //< resolution of \a mLut
+		std::vector< ci::Vec2f > mLut; //< mapped positions of the (resolution + 1)^2 cell corners
+		float mLutMaxError; //< maximum distance between the interpolated and the exact mapping
+		/** Samples the triangle grid mapping into \a mLut and measures its error.
+		 *  Runs on the UI thread, only when the calibration, the model or the
+		 *  table size changes and the cache does not have the table. It evaluates
+		 *  mapExact() (resolution + 1)^2 times and map() and mapExact() at the
+		 *  resolution^2 cell centers. At the default size of 256 this takes about
+		 *  10 ms with the triangle model and 200 ms with the thin plate spline
+		 *  of a 16x15 grid, three to four times that at 512. **/
+		void setupLookupTable();
+		/** Maps four points from the lookup table. Returns false without
+		 *  mapping if any of the points is outside of the camera image. **/
+		bool mapLut4( const ci::Vec2f *src, ci::Vec2f *dst ) const;
 
 		// config
 		ci::fs::path mConfigFile;
+		ci::fs::path getCacheFile() const;
+		//! Restores the calibration from the cache built from calibration file hash \a key.
+		bool loadCache( uint64_t key );
+		void saveCache( uint64_t key );
 
 		// params
 		ci::params::PInterfaceGl mParams;
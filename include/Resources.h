@@ -15,6 +15,8 @@
 #define RES_STROKE_VERT CINDER_RESOURCE( ../resources/, shaders/Stroke.vert, 135, GLSL )
 #define RES_STROKE_FRAG CINDER_RESOURCE( ../resources/, shaders/Stroke.frag, 136, GLSL )
 #define RES_STROKE_GEOM CINDER_RESOURCE( ../resources/, shaders/Stroke.geom, 137, GLSL )
+#define RES_STROKE_CAPSULE_VERT CINDER_RESOURCE( ../resources/, shaders/StrokeCapsule.vert, 160, GLSL )
+#define RES_STROKE_CAPSULE_FRAG CINDER_RESOURCE( ../resources/, shaders/StrokeCapsule.frag, 161, GLSL )
 
 #define RES_MENU_BACKGROUND CINDER_RESOURCE( ../resources/, gfx/menu/background.png, 139, PNG )
 #define RES_MENU_HU_CLEAR_ON CINDER_RESOURCE( ../resources/, gfx/menu/hu_clear_on.png, 140, PNG )
@@ -0,0 +1,70 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Filesystem.h"
+
+#include "Blob.h"
+#include "BlobEventLog.h"
+
+namespace mndl {
+
+class BlobTracker;
+
+/** Replays recorded sessions frame by frame through the blob detection and
+ *  tracking and compares the resulting events with the golden event log
+ *  stored next to the movie. Golden logs are only written by an explicit
+ *  record run, a session without one fails the replay. **/
+class SessionReplay
+{
+	public:
+		struct Result
+		{
+			ci::fs::path mSession;
+			uint32_t mFrames;
+			double mFps; //< replayed frames per second including movie decoding
+			double mTrackingFps; //< frames per second of detection and tracking
+			bool mRecorded; //< golden log recorded by this run
+			bool mGoldenMissing; //< no golden log to compare with
+			BlobEventLog::Diff mDiff;
+		};
+
+		/** Replays all movies in \a folder with the detection and tracking
+		 *  settings of \a config. Events are expected within \a tolerance of
+		 *  the golden events in normalized coordinates. If \a record is true
+		 *  the golden logs are (re)written instead of compared. **/
+		static std::vector< Result > run( const BlobTracker &config, const ci::fs::path &folder,
+										  float tolerance, bool record = false );
+		static void print( const std::vector< Result > &results, std::ostream &out );
+
+	private:
+		SessionReplay() : mFrame( 0 ) {}
+
+		bool replay( const BlobTracker &config, const ci::fs::path &moviePath,
+					 float tolerance, bool record, Result *result );
+		void blobsFrame( const BlobFrameEvent &event );
+
+		uint32_t mFrame;
+		BlobEventLog mLog;
+};
+
+} // namespace mndl
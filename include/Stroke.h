@@ -2,38 +2,41 @@
 
 #include <vector>
 
-#include "cinder/app/App.h"
-#include "cinder/gl/gl.h"
-#include "cinder/gl/Vbo.h"
-#include "cinder/gl/GlslProg.h"
 #include "cinder/Color.h"
 #include "cinder/Vector.h"
 
+/** Polyline of a pen stroke as lines with adjacency, drawn by StrokeBatch. **/
 class Stroke
 {
 	 public:
 		 Stroke();
 
-		 void resize( ci::app::ResizeEvent event ) { mWindowSize = ci::Vec2f( event.getSize() ); }
-
 		 void update( ci::Vec2f point );
-		 void draw();
 
-		 void clear() { mPoints.clear(); }
+		 void clear();
 
 		 void setColor( ci::ColorA c ) { mColor = c; }
+		 const ci::ColorA & getColor() const { return mColor; }
 		 void setThickness( float t ) { mThickness = t; }
+		 float getThickness() const { return mThickness; }
+
+		 size_t getNumSegments() const { return ( mVertices.size() < 4 ) ? 0 : mVertices.size() - 3; }
+		 /** Returns the points with an adjacency vertex at both ends. Segment
+		  *  \a i is drawn from the vertices \a i to \a i + 3. **/
+		 const std::vector< ci::Vec2f > & getVertices() const { return mVertices; }
+
+		 //! Number of segments already drawn into the canvas.
+		 size_t getSegmentsDrawn() const { return mSegmentsDrawn; }
+		 void setSegmentsDrawn( size_t n ) { mSegmentsDrawn = n; }
 
 	private:
 		float mThickness;
-		float mLimit;
 		ci::ColorA mColor;
 
 		std::vector< ci::Vec2f > mPoints;
-		static ci::gl::GlslProg sShader;
 
-		ci::Vec2f mWindowSize;
-
-		ci::gl::VboMesh mVboMesh;
+		// Adding a point only changes the last two vertices, the earlier
+		// segments remain valid.
+		std::vector< ci::Vec2f > mVertices;
+		size_t mSegmentsDrawn;
 };
-
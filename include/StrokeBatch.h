@@ -0,0 +1,115 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Vbo.h"
+#include "cinder/Color.h"
+#include "cinder/Vector.h"
+
+#include "Stroke.h"
+
+/** Draws the segments of several strokes with one program bind and one draw
+ *  call. Color and thickness are vertex attributes, so strokes with
+ *  different brushes share the buffer. **/
+class StrokeBatch
+{
+	public:
+		StrokeBatch();
+
+		enum Renderer
+		{
+			RENDERER_GEOMETRY_SHADER = 0, //< lines with adjacency expanded by Stroke.geom
+			RENDERER_TESSELLATOR, //< triangles built by StrokeTessellator
+			RENDERER_CAPSULES //< instanced quads with antialiased capsule distance, round joins
+		};
+
+		//! Loads the stroke shaders, needs a current GL context.
+		void setup();
+		//! Sets the size of the target in pixels.
+		void resize( const ci::Vec2i &size ) { mWindowSize = ci::Vec2f( size ); }
+
+		void setRenderer( Renderer renderer ) { mRenderer = renderer; }
+		Renderer getRenderer() const { return mRenderer; }
+		//! Returns false if \a renderer could not be set up, the tessellator is used instead.
+		bool isSupported( Renderer renderer ) const;
+
+		/** Adds the segments of \a stroke not drawn yet, and the segment
+		 *  before them to complete its join with the new ones. The
+		 *  segments are marked as drawn in \a stroke. **/
+		void add( Stroke &stroke );
+		//! Draws the added segments and empties the batch.
+		void draw();
+		void clear();
+
+		size_t getNumSegments() const { return mWidths.size(); }
+
+	private:
+		Renderer mRenderer;
+
+		// segments added since the last draw
+		std::vector< ci::Vec2f > mPoints; //< four lines with adjacency points for each segment
+		std::vector< ci::ColorA > mColors;
+		std::vector< float > mWidths;
+		std::vector< bool > mRedrawn; //< segment drawn before, added again to complete its join
+
+		struct Vertex
+		{
+			ci::Vec2f mPos;
+			ci::ColorA mColor;
+			float mThickness;
+		};
+		std::vector< Vertex > mVertices; //< vertices of the geometry shader renderer
+
+		struct TriangleVertex
+		{
+			ci::Vec2f mPos;
+			ci::ColorA mColor;
+		};
+		std::vector< ci::Vec2f > mTriangles; //< output of the tessellator
+		std::vector< TriangleVertex > mTriangleVertices;
+
+		ci::gl::Vbo mVbo;
+		size_t mCapacity; //< bytes allocated in \a mVbo
+		/** Orphans the storage of \a mVbo, uploads \a size bytes to its
+		 *  beginning and leaves it bound. **/
+		void upload( const void *data, size_t size );
+
+		struct Instance
+		{
+			ci::Vec2f mStart;
+			ci::Vec2f mEnd;
+			ci::ColorA mColor;
+			float mWidth;
+		};
+		std::vector< Instance > mInstances; //< segments of the capsule renderer
+		ci::gl::Vbo mQuadVbo; //< corners of the quad instanced for the segments
+
+		void drawGeometryShader();
+		void drawTessellated();
+		void drawCapsules();
+
+		ci::gl::GlslProg mShader;
+		ci::gl::GlslProg mCapsuleShader; //< empty if instancing is not supported
+		float mLimit;
+		ci::Vec2f mWindowSize;
+};
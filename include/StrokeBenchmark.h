@@ -0,0 +1,78 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include "Stroke.h"
+
+/** Measures the CPU stroke tessellator on generated strokes and compares
+ *  its triangles with a direct port of the math in Stroke.geom. Also
+ *  measures the draw time of the StrokeBatch renderers. **/
+class StrokeBenchmark
+{
+	public:
+		struct Result
+		{
+			std::string mMethod;
+			size_t mSegments;
+			double mNsPerSegment;
+			float mMaxError; //< maximum distance from the vertices of the shader math in pixels
+			size_t mMismatches; //< segments with a vertex further than the tolerance
+		};
+
+		struct RendererResult
+		{
+			std::string mRenderer;
+			size_t mSegments;
+			double mMsPerFrame;
+			double mNsPerSegment;
+		};
+
+		static std::vector< Result > runTessellator( size_t segments = 20000 );
+		static void print( const std::vector< Result > &results, std::ostream &out );
+
+		/** Draws all segments of generated strokes \a frames times into an
+		 *  offscreen target of \a size pixels with each renderer, with alpha
+		 *  blending as the app draws. Needs a current GL context. **/
+		static std::vector< RendererResult > runRenderers( const ci::Vec2i &size,
+				size_t segments = 20000, size_t frames = 20 );
+		static void print( const std::vector< RendererResult > &results, std::ostream &out );
+
+	private:
+		//! Generates random walk strokes with sharp turns, \a segments segments at least.
+		static std::vector< Stroke > generateStrokes( size_t segments, const ci::Vec2f &size );
+		//! Four lines with adjacency points and the width of \a segments generated segments.
+		static void generateSegments( size_t segments, std::vector< ci::Vec2f > *points,
+				std::vector< float > *widths );
+
+		/** Runs the geometry shader math on a segment in pixels drawn to a
+		 *  target of \a size pixels. Writes the emitted vertices in pixels in
+		 *  the order of StrokeTessellator. **/
+		static void shaderSegment( const ci::Vec2f *points, float thickness, float miterLimit,
+				const ci::Vec2f &size, ci::Vec2f *out );
+
+		static void compare( const std::vector< ci::Vec2f > &reference,
+				const std::vector< ci::Vec2f > &vertices, Result *result );
+};
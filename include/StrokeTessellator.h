@@ -0,0 +1,45 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+/** Builds the triangles of stroke segments on the CPU with the miter and
+ *  miter limit logic of Stroke.geom, for drivers where geometry shaders are
+ *  slow or missing. Works in pixels, the shader's naive culling is left out. **/
+class StrokeTessellator
+{
+	public:
+		/** Number of triangle vertices written for each segment: the triangle
+		 *  closing the gap at a sharp start, degenerate if there is none, and
+		 *  two triangles of the segment. **/
+		static const size_t VERTICES_PER_SEGMENT = 9;
+
+		/** Tessellates \a count segments of lines with adjacency. Segment \a i
+		 *  is defined by \a points[ 4 * i ] to \a points[ 4 * i + 3 ] and is
+		 *  \a widths[ i ] pixels wide. Writes VERTICES_PER_SEGMENT * \a count
+		 *  vertices to \a out. Four segments are processed at once with SSE2
+		 *  when it is available. **/
+		static void tessellate( const ci::Vec2f *points, const float *widths, size_t count,
+				float miterLimit, ci::Vec2f *out );
+		//! One segment at a time version of tessellate().
+		static void tessellateScalar( const ci::Vec2f *points, const float *widths, size_t count,
+				float miterLimit, ci::Vec2f *out );
+};
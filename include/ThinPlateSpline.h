@@ -0,0 +1,58 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+namespace mndl {
+
+/** Smooth 2d mapping interpolating between control points. The spline
+ *  bends the least while passing through the target of each control point,
+ *  and continues as an affine mapping far from them. Evaluation costs one
+ *  logarithm per control point, so it is meant to be sampled into a lookup
+ *  table rather than evaluated per blob. **/
+class ThinPlateSpline
+{
+	public:
+		ThinPlateSpline() { clear(); }
+
+		/** Fits the spline mapping \a src[ i ] to \a dst[ i ]. Nonzero \a smoothing
+		 *  relaxes the interpolation into an approximation. Returns false and
+		 *  clears the spline if the points are degenerate, e.g. all on a line. **/
+		bool fit( const std::vector< ci::Vec2f > &src, const std::vector< ci::Vec2f > &dst, double smoothing = 0. );
+		//! Clears the spline to the identity mapping.
+		void clear();
+
+		bool isFitted() const { return !mCenters.empty(); }
+
+		ci::Vec2f map( const ci::Vec2f &p ) const;
+
+	private:
+		std::vector< ci::Vec2d > mCenters; //< control point sources
+		std::vector< ci::Vec2d > mWeights; //< kernel weights of the control points
+		ci::Vec2d mAffine[ 3 ]; //< constant, x and y coefficients of the affine part
+
+		//! Radial basis function of the squared distance \a r2
+		static double kernel( double r2 ) { return ( r2 > 0. ) ? r2 * log( r2 ) : 0.; }
+};
+
+} // namespace mndl
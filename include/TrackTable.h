@@ -0,0 +1,143 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "Blob.h"
+
+namespace mndl {
+
+//! Refers to a track in a TrackTable, stays valid until the track is removed
+struct TrackHandle
+{
+	TrackHandle() : mSlot( INVALID_SLOT ), mGeneration( 0 ) {}
+	TrackHandle( uint32_t slot, uint32_t generation ) :
+		mSlot( slot ), mGeneration( generation ) {}
+
+	bool operator==( const TrackHandle &rhs ) const
+	{
+		return ( mSlot == rhs.mSlot ) && ( mGeneration == rhs.mGeneration );
+	}
+	bool operator!=( const TrackHandle &rhs ) const { return !( *this == rhs ); }
+
+	static const uint32_t INVALID_SLOT = 0xffffffff;
+
+	uint32_t mSlot;
+	uint32_t mGeneration;
+};
+
+/** Structure-of-arrays storage of the tracked blobs.
+ *  Tracks are stored densely, removal swaps the last track into the place
+ *  of the removed one. Handles go through a slot indirection and carry a
+ *  generation counter, so a handle of a removed track is never mistaken
+ *  for the track reusing its slot. Storage is preallocated, adding and
+ *  removing tracks does not allocate until the capacity is exceeded. **/
+class TrackTable
+{
+	public:
+		enum State
+		{
+			STATE_ACTIVE = 0, //< detected in the last frame
+			STATE_COASTING, //< lost, kept alive at its last position
+			STATE_MERGED //< sharing a blob with touching tracks
+		};
+
+		TrackTable( size_t capacity = 64 );
+
+		//! Preallocates storage for \a capacity tracks.
+		void reserve( size_t capacity );
+
+		size_t size() const { return mIds.size(); }
+		bool empty() const { return mIds.empty(); }
+		void clear();
+
+		//! Adds a track initialized from \a blob and returns its handle.
+		TrackHandle add( const Blob &blob, double time );
+		//! Removes the track at dense index \a i, the last track is moved to its place.
+		void removeAt( size_t i );
+		//! Removes the track referred by \a handle. Returns false if the handle is stale.
+		bool remove( const TrackHandle &handle );
+
+		//! Returns true if \a handle refers to a living track.
+		bool isValid( const TrackHandle &handle ) const;
+		//! Returns the dense index of the track referred by \a handle or -1 if the handle is stale.
+		int32_t indexOf( const TrackHandle &handle ) const;
+		//! Returns the handle of the track at dense index \a i.
+		TrackHandle getHandle( size_t i ) const;
+
+		//! Returns the track at dense index \a i as a blob.
+		Blob getBlob( size_t i ) const;
+
+		int32_t getId( size_t i ) const { return mIds[ i ]; }
+		const ci::Vec2f & getCentroid( size_t i ) const { return mCentroids[ i ]; }
+		const ci::Vec2f & getPrevCentroid( size_t i ) const { return mPrevCentroids[ i ]; }
+		const ci::Rectf & getBoundingBox( size_t i ) const { return mBboxes[ i ]; }
+		State getState( size_t i ) const { return (State)mStates[ i ]; }
+		bool isCoasting( size_t i ) const { return mStates[ i ] == STATE_COASTING; }
+		bool isMerged( size_t i ) const { return mStates[ i ] == STATE_MERGED; }
+		//! Returns the area of the track's own blob, kept from before a merge.
+		float getArea( size_t i ) const { return mAreas[ i ]; }
+		//! Returns the displacement of the track in the last frame.
+		const ci::Vec2f & getVelocity( size_t i ) const { return mVelocities[ i ]; }
+		/** Returns the expected centroid of the track in the next frame. Merged
+		 *  tracks are expected on their side of the merged blob. **/
+		ci::Vec2f getPredictedCentroid( size_t i ) const;
+		int32_t getMissedFrames( size_t i ) const { return mMissedFrames[ i ]; }
+		double getLastSeen( size_t i ) const { return mLastSeen[ i ]; }
+
+		//! Returns the centroids of all tracks as a contiguous array.
+		const ci::Vec2f * getCentroids() const { return mCentroids.empty() ? NULL : &mCentroids[ 0 ]; }
+
+		//! Updates the track at dense index \a i with the detected \a blob.
+		void update( size_t i, const Blob &blob, double time );
+		/** Moves the track at dense index \a i to the \a blob merged from
+		 *  touching tracks. The area of the track and its offset from the
+		 *  merged blob are kept, so the track can be told apart when the
+		 *  blob splits again. **/
+		void merge( size_t i, const Blob &blob, double time );
+		//! Marks the track at dense index \a i lost in the current frame.
+		void miss( size_t i );
+		//! Forgets the velocity of the track at dense index \a i, it is predicted at its centroid.
+		void clearVelocity( size_t i ) { mVelocities[ i ] = ci::Vec2f::zero(); }
+
+	private:
+		// dense track data, index i refers to the same track in all arrays
+		std::vector< int32_t > mIds;
+		std::vector< ci::Vec2f > mCentroids;
+		std::vector< ci::Vec2f > mPrevCentroids;
+		std::vector< ci::Rectf > mBboxes;
+		std::vector< float > mAreas;
+		std::vector< ci::Vec2f > mVelocities;
+		std::vector< ci::Vec2f > mMergeOffsets; //< position relative to the merged blob
+		std::vector< uint8_t > mStates;
+		std::vector< int32_t > mMissedFrames;
+		std::vector< double > mLastSeen;
+		std::vector< uint32_t > mSlots; //< slot of the track at dense index i
+
+		// slot indirection for the handles
+		std::vector< uint32_t > mSlotIndices; //< dense index of the track in slot
+		std::vector< uint32_t > mSlotGenerations; //< generation of slot
+		std::vector< uint32_t > mFreeSlots;
+};
+
+} // namespace mndl
@@ -0,0 +1,87 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "Blob.h"
+
+namespace mndl {
+
+class BlobTracker;
+
+/** Drives BlobTracker::trackBlobs with generated pen trajectories and
+ *  measures the tracking time and the stability of the blob ids against
+ *  the known ground truth. **/
+class TrackerBenchmark
+{
+	public:
+		struct Result
+		{
+			std::string mScenario;
+			size_t mFrames;
+			double mNsPerFrame; //< average trackBlobs time in nanoseconds
+			int32_t mGroundTruthTracks; //< number of generated pens
+			int32_t mTracks; //< number of tracks started by the tracker
+			int32_t mIdSwitches; //< pen continued with a different blob id
+			int32_t mFragmentations; //< tracking of a pen interrupted and resumed
+			int32_t mFalseTracks; //< tracks started in excess of the generated pens
+			float mMeanTrackLifetime; //< in frames
+		};
+
+		//! Runs all scenarios with the coasting settings of \a config.
+		static std::vector< Result > run( const BlobTracker &config, size_t frames = 600 );
+		static void print( const std::vector< Result > &results, std::ostream &out );
+
+	private:
+		//! Blob detection generated from one or two pens touching each other
+		struct Detection
+		{
+			Detection() : mArea( 0.f ) { mGt[ 0 ] = mGt[ 1 ] = -1; }
+
+			ci::Vec2f mPos;
+			ci::Rectf mBbox;
+			float mArea;
+			int32_t mGt[ 2 ]; //< ground truth ids of the pens
+		};
+
+		struct Scenario
+		{
+			std::string mName;
+			int32_t mGroundTruthTracks;
+			std::vector< std::vector< Detection > > mDetections; //< detections per frame
+			std::vector< std::vector< int32_t > > mPresent; //< ground truth ids present per frame
+		};
+
+		static Scenario generateCrossing( size_t frames );
+		static Scenario generateMerges( size_t frames );
+		static Scenario generateSplits( size_t frames );
+		static Scenario generateDropouts( size_t frames );
+		static Detection makeDetection( const ci::Vec2f &pos, int32_t gt );
+		static Detection mergeDetections( const Detection &a, const Detection &b );
+
+		static Result runScenario( const BlobTracker &config, const Scenario &scenario );
+};
+
+} // namespace mndl
@@ -0,0 +1,69 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+
+#include "Blob.h"
+#include "TrackTable.h"
+#include "Tuio.h"
+
+namespace mndl {
+
+/** Sends generated blob frames through the blob transports on the local
+ *  machine, checks that the received frames match the sent tracks and
+ *  measures the latency from sending a frame to receiving it. The shared
+ *  memory channel is checked against its 50 us latency requirement. **/
+class TransportBenchmark
+{
+	public:
+		struct Result
+		{
+			std::string mTransport;
+			size_t mFrames;
+			size_t mReceived; //< frames arrived before the timeout
+			size_t mMismatches; //< received frames differing from the sent tracks
+			double mUsPerFrame; //< average latency of the received frames in microseconds
+			double mTargetUs; //< latency required from the transport, 0 if there is no requirement
+		};
+
+		//! Runs all transports with \a frames frames each.
+		static std::vector< Result > run( size_t frames = 200 );
+		static void print( const std::vector< Result > &results, std::ostream &out );
+
+	private:
+		/** Sends the frames over UDP to a receiver on localhost. If \a restart
+		 *  is true, the sender is replaced halfway, restarting the frame
+		 *  numbering. **/
+		static Result runTuio( TuioSender::Version version, bool restart, size_t frames );
+		/** Writes the frames to a BlobChannel read by another thread polling
+		 *  it continuously, as the rendering process does. **/
+		static Result runSharedMemory( size_t frames );
+
+		//! Moves the generated blobs of frame \a frame into \a tracks and \a events.
+		static void generateFrame( size_t frame, size_t frames, TrackTable *tracks,
+				std::vector< BlobEvent > *events );
+		//! Returns true if \a blobs are the tracks of \a tracks.
+		static bool matches( const TrackTable &tracks, const std::vector< Blob > &blobs );
+};
+
+} // namespace mndl
@@ -177,7 +177,8 @@ protected:
 	static ci::RectT<T>	calcBoundingBox( const TriangleT<T> &triangle );
 	static ci::Vec2<T>	calcCentroid( const TriangleT<T> &triangle );
 	static ci::Vec2<T>	calcPoint( const ci::Vec2<T> &origin, T distance, T radians );
-	static ci::Vec2<T>	closestPoint( const TriangleT<T> &triangle, const ci::Vec2<T> &p, int32_t n = 0 );
+	static ci::Vec2<T>	closestPoint( const TriangleT<T> &triangle, const ci::Vec2<T> &p );
+	static ci::Vec2<T>	closestVertex( const TriangleT<T> &triangle, const ci::Vec2<T> &p, int32_t n = 0 );
 	static bool			contains( const TriangleT<T> &triangle, const ci::Vec2<T> &p );
 	static T			distance( const TriangleT<T> &triangle, const ci::Vec2<T> &p );
 	static T			distanceSquared( const TriangleT<T> &triangle, const ci::Vec2<T> &p );
@@ -191,22 +192,6 @@ protected:
 
 	template<typename T2>
 	friend				std::ostream& operator<<( std::ostream &out, const TriangleT<T> &triangle );
-
-	///////////////////////////////////////////////////////////////////////////////
-
-	class PointSort
-	{
-	public:
-		PointSort( const ci::Vec2<T> &point = ci::Vec2<T>::zero(), T distance = (T)0.0 );
-		bool			operator<( const PointSort &rhs ) const;
-		bool			operator==( const PointSort &rhs ) const;
-		bool			operator!=( const PointSort &rhs ) const;
-	private:
-		T				mDistance;
-		ci::Vec2<T>		mPoint;
-		friend class	TriangleT<T>;
-	};
-
 };
 
 ///////////////////////////////////////////////////////////////////////////////
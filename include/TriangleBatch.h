@@ -0,0 +1,82 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Vector.h"
+
+#include "Triangle.h"
+
+namespace mndl {
+
+/** Triangles stored as structure of arrays for testing a point against
+ *  many triangles at once. The float queries run on four triangles at a
+ *  time with SSE2 when the compiler targets it, other types and targets
+ *  use the scalar implementation. Degenerate triangles contain no point,
+ *  their barycentric coordinates are NaN. The result arrays of the
+ *  queries have size() elements. **/
+template< typename T >
+class TriangleBatch
+{
+	public:
+		TriangleBatch() : mSize( 0 ) {}
+
+		void clear();
+		void reserve( size_t n );
+		void push_back( const TriangleT< T > &triangle );
+
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		TriangleT< T > getTriangle( size_t i ) const;
+
+		//! Sets \a result[ i ] to 1 if triangle \a i contains \a p, to 0 otherwise.
+		void contains( const ci::Vec2< T > &p, uint8_t *result ) const;
+		void toBarycentric( const ci::Vec2< T > &p, ci::Vec3< T > *result ) const;
+		//! Sets \a result[ i ] to the squared distance of \a p from triangle \a i, 0 if \a p is inside.
+		void distanceSquared( const ci::Vec2< T > &p, T *result ) const;
+
+		//! Returns the index of the first triangle containing \a p or -1.
+		int32_t findContaining( const ci::Vec2< T > &p ) const;
+		//! Returns the index of the triangle closest to \a p or -1 if the batch is empty.
+		int32_t findClosest( const ci::Vec2< T > &p, T *distanceSquared = NULL ) const;
+
+		//! Triangles are processed in blocks of this size, arrays are padded to it
+		static const size_t BLOCK_SIZE = 8;
+
+	private:
+		size_t mSize;
+
+		// vertices
+		std::vector< T > mAx, mAy, mBx, mBy, mCx, mCy;
+		// rows of the inverse barycentric basis ( a - c, b - c )
+		std::vector< T > mInv0, mInv1, mInv2, mInv3;
+		// inverse squared lengths of the edges ab, bc and ca, 0 for zero length edges
+		std::vector< T > mInvAb, mInvBc, mInvCa;
+
+		//! Processes the block starting at triangle \a i, \a result has BLOCK_SIZE elements.
+		void containsBlock( size_t i, const ci::Vec2< T > &p, uint8_t *result ) const;
+		void toBarycentricBlock( size_t i, const ci::Vec2< T > &p, T *l1, T *l2 ) const;
+		void distanceSquaredBlock( size_t i, const ci::Vec2< T > &p, T *result ) const;
+};
+
+typedef TriangleBatch< float > TriangleBatchf;
+typedef TriangleBatch< double > TriangleBatchd;
+
+} // namespace mndl
@@ -0,0 +1,74 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "cinder/Cinder.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+
+#include "BarycentricTriangle.h"
+#include "TriangleBatch.h"
+
+namespace mndl {
+
+/** Point location in a triangulated calibration grid.
+ *  The triangles are expected in the order ManualCalibration creates
+ *  them, two triangles per grid cell, row by row. A point is searched by
+ *  walking from the last triangle found towards the point through the
+ *  neighbouring triangles, and if the walk does not end in a few steps,
+ *  among the triangles of a uniform bucket grid laid over the triangles.
+ *  Points outside of the grid are assigned to the closest of the triangles
+ *  on the border of the grid, which are tested together in a TriangleBatch. **/
+class TriangleLocator
+{
+	public:
+		TriangleLocator() : mGridSize( 0, 0 ), mBucketCount( 0, 0 ), mLastHit( -1 ) {}
+
+		/** Sets up the locator for \a triangles of a grid with \a gridSize
+		 *  points along each axis. **/
+		void setup( const std::vector< BarycentricTrianglef > &triangles, const ci::Vec2i &gridSize );
+
+		//! Returns the index of the triangle containing \a p or -1 if \a p is outside of the grid.
+		int32_t locate( const ci::Vec2f &p );
+		//! Returns the index of the triangle containing \a p or the triangle closest to \a p.
+		int32_t locateClosest( const ci::Vec2f &p );
+
+	private:
+		std::vector< BarycentricTrianglef > mTriangles;
+		ci::Vec2i mGridSize;
+
+		ci::Rectf mBounds; //< bounding box of the triangles
+		ci::Vec2i mBucketCount;
+		ci::Vec2f mBucketScale; //< bucket coordinates per unit
+		std::vector< int32_t > mBucketStart; //< first index in \a mBucketTriangles per bucket
+		std::vector< int32_t > mBucketTriangles; //< triangles overlapping the buckets
+
+		TriangleBatchf mBorder; //< triangles with an edge on the border of the grid
+		std::vector< int32_t > mBorderTriangles; //< indices of the \a mBorder triangles
+		void addBorderTriangle( int32_t triangle );
+
+		int32_t mLastHit; //< triangle found last, start of the next walk
+
+		int32_t walk( int32_t triangle, const ci::Vec2f &p ) const;
+		int32_t searchBuckets( const ci::Vec2f &p ) const;
+		ci::Vec2i getBucket( const ci::Vec2f &p ) const;
+};
+
+} // namespace mndl
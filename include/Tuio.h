@@ -0,0 +1,95 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cinder/Cinder.h"
+
+#include "Blob.h"
+#include "TrackTable.h"
+
+namespace mndl {
+
+/** Sends blob frames as TUIO cursors over UDP.
+ *  Each frame is encoded into one OSC bundle in a preallocated buffer. TUIO 1.1
+ *  bundles contain the /tuio/2Dcur source, alive, set and fseq messages,
+ *  TUIO 2.0 bundles the /tuio2/frm, ptr and alv messages. Positions are
+ *  normalized camera coordinates, so the receiving side is calibrated. **/
+class TuioSender
+{
+	public:
+		enum Version
+		{
+			TUIO_1_1 = 0,
+			TUIO_2_0
+		};
+
+		TuioSender() {}
+
+		/** Opens the socket sending to \a host and \a port. Returns false on error,
+		 *  the host and port are forgotten then, so opening is retried. **/
+		bool open( const std::string &host, int port );
+		//! Closes the socket and forgets the host and port.
+		void close();
+		bool isOpen() const;
+
+		const std::string & getHost() const;
+		int getPort() const;
+
+		void setVersion( Version version );
+		//! Sets the sensor dimension reported in TUIO 2.0 frame messages
+		void setDimension( int width, int height );
+
+		/** Sends the blobs of \a tracks as alive and the blobs changed in \a event.
+		 *  \param now time of the frame in seconds for the velocities **/
+		void send( const TrackTable &tracks, const BlobFrameEvent &event, double now );
+
+	protected:
+		struct Obj;
+		std::shared_ptr< Obj > mObj;
+};
+
+/** Receives TUIO 1.1 and 2.0 cursor bundles over UDP in a background
+ *  thread and collects the complete frames for the main thread. Late
+ *  frames are dropped by their frame number, which starts over when the
+ *  sender changes or no packet arrives for a second. **/
+class TuioReceiver
+{
+	public:
+		TuioReceiver() {}
+
+		/** Starts listening on \a port. Returns false on error, the port is
+		 *  not reported by getPort() then, so opening is retried. **/
+		bool open( int port );
+		void close();
+		bool isOpen() const;
+
+		int getPort() const;
+
+		/** Moves the blobs of the oldest received frame to \a blobs.
+		 *  Returns false if there is no frame waiting. **/
+		bool popFrame( std::vector< Blob > *blobs );
+
+	protected:
+		struct Obj;
+		std::shared_ptr< Obj > mObj;
+};
+
+} // namespace mndl
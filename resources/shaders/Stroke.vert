@@ -6,6 +6,7 @@ void main(void)
 {
 	gl_FrontColor = gl_Color;
 	gl_BackColor = gl_Color;
+	gl_TexCoord[0] = gl_MultiTexCoord0; // x: thickness of the stroke
 
 	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
 }
\ No newline at end of file
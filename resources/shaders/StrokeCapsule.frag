@@ -0,0 +1,23 @@
+// ------------------ Fragment Shader --------------------------------
+#version 120
+
+varying vec2 vPos;
+varying vec4 vSegment;
+varying float vRadius;
+varying vec4 vColor;
+
+void main(void)
+{
+	// signed distance from the capsule around the segment, consecutive
+	// capsules overlap in round joins
+	vec2 pa = vPos - vSegment.xy;
+	vec2 ba = vSegment.zw - vSegment.xy;
+	float h = clamp( dot( pa, ba ) / max( dot( ba, ba ), 1e-6 ), 0.0, 1.0 );
+	float d = length( pa - ba * h ) - vRadius;
+
+	float coverage = clamp( 0.5 - d, 0.0, 1.0 );
+	if ( coverage <= 0.0 )
+		discard;
+
+	gl_FragColor = vec4( vColor.rgb, vColor.a * coverage );
+}
@@ -0,0 +1,35 @@
+// ------------------ Vertex Shader --------------------------------
+// one instance for each stroke segment, the corners of a unit quad in
+// gl_Vertex are stretched to the bounding box of the capsule around the segment
+#version 120
+
+attribute vec4 segment;		// per instance, start and end of the segment in pixels
+attribute vec4 color;		// per instance
+attribute float width;		// per instance, width of the stroke in pixels
+
+varying vec2 vPos;
+varying vec4 vSegment;
+varying float vRadius;
+varying vec4 vColor;
+
+void main(void)
+{
+	vec2 corner = gl_Vertex.xy; // (-1, -1) - (1, 1)
+	vec2 a = segment.xy;
+	vec2 b = segment.zw;
+	float len = length( b - a );
+	vec2 dir = len > 0.0 ? ( b - a ) / len : vec2( 1.0, 0.0 );
+	vec2 nrm = vec2( -dir.y, dir.x );
+
+	// one pixel margin for the antialiased edge
+	float radius = 0.5 * width;
+	float extent = radius + 1.0;
+	vec2 pos = 0.5 * ( a + b ) + dir * corner.x * ( 0.5 * len + extent ) + nrm * corner.y * extent;
+
+	vPos = pos;
+	vSegment = segment;
+	vRadius = radius;
+	vColor = color;
+
+	gl_Position = gl_ModelViewProjectionMatrix * vec4( pos, 0.0, 1.0 );
+}
@@ -0,0 +1,247 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#if defined( CINDER_MSW )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+#include "cinder/app/App.h"
+
+#include "BlobChannel.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+static const uint32_t CHANNEL_MAGIC = 0x49524231; // IRB1
+// attempts to read a slot while it is being written
+static const int MAX_READ_RETRIES = 16;
+
+#if defined( CINDER_MSW )
+#define MEMORY_BARRIER() MemoryBarrier()
+#else
+#define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+BlobChannel::BlobChannel() :
+	mShared( NULL ),
+	mWriter( false ),
+	mReadIndex( 0 ),
+	mDroppedFrames( 0 )
+{
+}
+
+BlobChannel::~BlobChannel()
+{
+	close();
+}
+
+bool BlobChannel::openWriter( const std::string &name )
+{
+	return open( name, true );
+}
+
+bool BlobChannel::openReader( const std::string &name )
+{
+	return open( name, false );
+}
+
+bool BlobChannel::open( const std::string &name, bool writer )
+{
+	close();
+	mName = name;
+	mWriter = writer;
+
+#if defined( CINDER_MSW )
+	app::console() << "Shared memory blob channel is not supported on this platform" << endl;
+	return false;
+#else
+	int fd = shm_open( name.c_str(), writer ? ( O_CREAT | O_RDWR ) : O_RDWR, 0666 );
+	if ( fd < 0 )
+	{
+		if ( writer )
+			app::console() << "Unable to open shared memory " << name << endl;
+		return false;
+	}
+
+	struct stat st;
+	if ( ( fstat( fd, &st ) < 0 ) ||
+		 ( ( st.st_size < (off_t)sizeof( Shared ) ) &&
+		   ( !writer || ( ftruncate( fd, sizeof( Shared ) ) < 0 ) ) ) )
+	{
+		::close( fd );
+		return false;
+	}
+
+	void *addr = mmap( NULL, sizeof( Shared ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	::close( fd );
+	if ( addr == MAP_FAILED )
+	{
+		app::console() << "Unable to map shared memory " << name << endl;
+		return false;
+	}
+	mShared = static_cast< Shared * >( addr );
+
+	if ( writer )
+	{
+		// a restarted writer continues the frame indices of the previous one,
+		// so the readers do not see them going backwards
+		if ( ( mShared->mMagic != CHANNEL_MAGIC ) || ( mShared->mSize != sizeof( Shared ) ) )
+		{
+			memset( mShared, 0, sizeof( Shared ) );
+			mShared->mSize = sizeof( Shared );
+			MEMORY_BARRIER();
+			mShared->mMagic = CHANNEL_MAGIC;
+		}
+
+		// a writer dying in the middle of write() leaves its slot odd, which
+		// would invert the parity of the slot for the new writer
+		for ( size_t i = 0; i < NUM_SLOTS; i++ )
+			mShared->mSlots[ i ].mSequence = ( mShared->mSlots[ i ].mSequence + 1 ) & ~1u;
+		MEMORY_BARRIER();
+	}
+	else
+	{
+		if ( ( mShared->mMagic != CHANNEL_MAGIC ) || ( mShared->mSize != sizeof( Shared ) ) )
+		{
+			close();
+			return false;
+		}
+		// start with the latest frame
+		mReadIndex = mShared->mWriteIndex;
+		mDroppedFrames = 0;
+	}
+	return true;
+#endif
+}
+
+void BlobChannel::close()
+{
+	if ( mShared == NULL )
+		return;
+
+#if !defined( CINDER_MSW )
+	munmap( mShared, sizeof( Shared ) );
+#endif
+	mShared = NULL;
+}
+
+void BlobChannel::write( const TrackTable &tracks, double time )
+{
+	if ( ( mShared == NULL ) || !mWriter )
+		return;
+
+	uint32_t index = mShared->mWriteIndex;
+	Slot &slot = mShared->mSlots[ index % NUM_SLOTS ];
+
+	// odd sequence marks the slot as being written
+	slot.mSequence++;
+	MEMORY_BARRIER();
+
+	size_t n = min( tracks.size(), MAX_BLOBS );
+	slot.mIndex = index;
+	slot.mNumBlobs = (uint32_t)n;
+	slot.mTime = time;
+	for ( size_t i = 0; i < n; i++ )
+	{
+		SharedBlob &b = slot.mBlobs[ i ];
+		const Vec2f &c = tracks.getCentroid( i );
+		const Rectf &bbox = tracks.getBoundingBox( i );
+		b.mId = tracks.getId( i );
+		b.mCentroid[ 0 ] = c.x;
+		b.mCentroid[ 1 ] = c.y;
+		b.mBbox[ 0 ] = bbox.x1;
+		b.mBbox[ 1 ] = bbox.y1;
+		b.mBbox[ 2 ] = bbox.x2;
+		b.mBbox[ 3 ] = bbox.y2;
+	}
+
+	MEMORY_BARRIER();
+	slot.mSequence++;
+	MEMORY_BARRIER();
+	mShared->mWriteIndex = index + 1;
+}
+
+bool BlobChannel::read( std::vector< Blob > *blobs, double *time )
+{
+	if ( ( mShared == NULL ) || mWriter )
+		return false;
+
+	uint32_t writeIndex = mShared->mWriteIndex;
+	MEMORY_BARRIER();
+
+	while ( mReadIndex != writeIndex )
+	{
+		// skip the frames already overwritten
+		uint32_t behind = writeIndex - mReadIndex;
+		if ( behind > NUM_SLOTS )
+		{
+			mDroppedFrames += behind - NUM_SLOTS;
+			mReadIndex = writeIndex - NUM_SLOTS;
+		}
+
+		uint32_t index = mReadIndex++;
+		if ( readSlot( index, blobs, time ) )
+			return true;
+		mDroppedFrames++;
+	}
+	return false;
+}
+
+bool BlobChannel::readSlot( uint32_t index, std::vector< Blob > *blobs, double *time ) const
+{
+	const Slot &slot = mShared->mSlots[ index % NUM_SLOTS ];
+
+	for ( int retry = 0; retry < MAX_READ_RETRIES; retry++ )
+	{
+		uint32_t seq = slot.mSequence;
+		if ( seq & 1 ) // being written
+			continue;
+		MEMORY_BARRIER();
+
+		uint32_t slotIndex = slot.mIndex;
+		size_t n = min( (size_t)slot.mNumBlobs, MAX_BLOBS );
+		blobs->resize( n );
+		for ( size_t i = 0; i < n; i++ )
+		{
+			const SharedBlob &sb = slot.mBlobs[ i ];
+			Blob &b = ( *blobs )[ i ];
+			b.mId = sb.mId;
+			b.mCentroid = b.mPrevCentroid = Vec2f( sb.mCentroid[ 0 ], sb.mCentroid[ 1 ] );
+			b.mBbox = Rectf( sb.mBbox[ 0 ], sb.mBbox[ 1 ], sb.mBbox[ 2 ], sb.mBbox[ 3 ] );
+		}
+		*time = slot.mTime;
+
+		MEMORY_BARRIER();
+		// the slot is reused by the writer if it got more than a ring ahead
+		if ( slot.mSequence == seq )
+			return slotIndex == index;
+	}
+	return false;
+}
+
+} // namespace mndl
@@ -0,0 +1,248 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <float.h>
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include "cinder/CinderMath.h"
+
+#include "BlobEventLog.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+static const char *LOG_HEADER = "# IRPaint blob event log 1";
+// number of differences described in Diff::mMessages
+static const size_t MAX_MESSAGES = 10;
+
+static char typeToChar( BlobEvent::Type type )
+{
+	switch ( type )
+	{
+		case BlobEvent::BLOB_BEGAN:
+			return 'b';
+		case BlobEvent::BLOB_MOVED:
+			return 'm';
+		default:
+			return 'e';
+	}
+}
+
+static const char *typeToString( BlobEvent::Type type )
+{
+	switch ( type )
+	{
+		case BlobEvent::BLOB_BEGAN:
+			return "began";
+		case BlobEvent::BLOB_MOVED:
+			return "moved";
+		default:
+			return "ended";
+	}
+}
+
+void BlobEventLog::add( uint32_t frame, const BlobFrameEvent &event )
+{
+	BlobEventRange events = event.getEvents();
+	for ( BlobEventRange::const_iterator it = events.begin(); it != events.end(); ++it )
+	{
+		Entry e;
+		e.mFrame = frame;
+		e.mType = it->getType();
+		e.mId = it->getId();
+		e.mPos = it->getPos();
+		mEntries.push_back( e );
+	}
+}
+
+bool BlobEventLog::write( const fs::path &path ) const
+{
+	ofstream out( path.string().c_str() );
+	if ( !out )
+		return false;
+
+	out << LOG_HEADER << endl;
+	out << setprecision( 7 );
+	for ( vector< Entry >::const_iterator it = mEntries.begin(); it != mEntries.end(); ++it )
+	{
+		out << it->mFrame << " " << typeToChar( it->mType ) << " " << it->mId << " " <<
+			it->mPos.x << " " << it->mPos.y << endl;
+	}
+	return out.good();
+}
+
+bool BlobEventLog::load( const fs::path &path )
+{
+	mEntries.clear();
+
+	ifstream in( path.string().c_str() );
+	if ( !in )
+		return false;
+
+	string line;
+	if ( !getline( in, line ) || ( line != LOG_HEADER ) )
+		return false;
+
+	while ( getline( in, line ) )
+	{
+		if ( line.empty() )
+			continue;
+
+		istringstream ss( line );
+		Entry e;
+		char type;
+		if ( !( ss >> e.mFrame >> type >> e.mId >> e.mPos.x >> e.mPos.y ) )
+			return false;
+
+		if ( type == 'b' )
+			e.mType = BlobEvent::BLOB_BEGAN;
+		else
+		if ( type == 'm' )
+			e.mType = BlobEvent::BLOB_MOVED;
+		else
+			e.mType = BlobEvent::BLOB_ENDED;
+		mEntries.push_back( e );
+	}
+	return true;
+}
+
+BlobEventLog::Diff BlobEventLog::compare( const BlobEventLog &golden, float tolerance ) const
+{
+	Diff diff;
+	diff.mEvents = mEntries.size();
+	diff.mGoldenEvents = golden.mEntries.size();
+
+	map< int32_t, int32_t > idMap; // golden blob id -> log blob id
+	vector< bool > used;
+
+	const vector< Entry > &gEntries = golden.mEntries;
+	size_t g = 0;
+	size_t l = 0;
+	while ( ( g < gEntries.size() ) || ( l < mEntries.size() ) )
+	{
+		// current frame is the earlier of the two logs
+		uint32_t frame = 0xffffffff;
+		if ( g < gEntries.size() )
+			frame = gEntries[ g ].mFrame;
+		if ( ( l < mEntries.size() ) && ( mEntries[ l ].mFrame < frame ) )
+			frame = mEntries[ l ].mFrame;
+		diff.mFrames++;
+
+		size_t gEnd = g;
+		while ( ( gEnd < gEntries.size() ) && ( gEntries[ gEnd ].mFrame == frame ) )
+			gEnd++;
+		size_t lEnd = l;
+		while ( ( lEnd < mEntries.size() ) && ( mEntries[ lEnd ].mFrame == frame ) )
+			lEnd++;
+
+		used.assign( lEnd - l, false );
+
+		// began events first, so the ids of the other events can be mapped
+		for ( int type = BlobEvent::BLOB_BEGAN; type <= BlobEvent::BLOB_ENDED; type++ )
+		{
+			for ( size_t i = g; i < gEnd; i++ )
+			{
+				const Entry &ge = gEntries[ i ];
+				if ( ge.mType != type )
+					continue;
+
+				map< int32_t, int32_t >::const_iterator mappedIt = idMap.find( ge.mId );
+
+				// began events match the closest unused began event,
+				// others the event of the mapped blob
+				int32_t match = -1;
+				float matchDist = FLT_MAX;
+				for ( size_t j = l; j < lEnd; j++ )
+				{
+					const Entry &le = mEntries[ j ];
+					if ( used[ j - l ] || ( le.mType != type ) )
+						continue;
+
+					if ( type == BlobEvent::BLOB_BEGAN )
+					{
+						float d = le.mPos.distance( ge.mPos );
+						if ( d < matchDist )
+						{
+							matchDist = d;
+							match = j;
+						}
+					}
+					else
+					if ( ( mappedIt != idMap.end() ) && ( mappedIt->second == le.mId ) )
+					{
+						matchDist = le.mPos.distance( ge.mPos );
+						match = j;
+						break;
+					}
+				}
+
+				stringstream msg;
+				if ( match == -1 )
+				{
+					diff.mMissing++;
+					msg << "frame " << frame << ": missing " << typeToString( ge.mType ) <<
+						" event of golden blob " << ge.mId;
+				}
+				else
+				{
+					used[ match - l ] = true;
+					if ( type == BlobEvent::BLOB_BEGAN )
+						idMap[ ge.mId ] = mEntries[ match ].mId;
+
+					diff.mMaxError = math< float >::max( diff.mMaxError, matchDist );
+					if ( matchDist > tolerance )
+					{
+						diff.mMoved++;
+						msg << "frame " << frame << ": " << typeToString( ge.mType ) <<
+							" event of golden blob " << ge.mId << " is off by " << matchDist;
+					}
+				}
+
+				if ( !msg.str().empty() && ( diff.mMessages.size() < MAX_MESSAGES ) )
+					diff.mMessages.push_back( msg.str() );
+			}
+		}
+
+		for ( size_t j = l; j < lEnd; j++ )
+		{
+			if ( used[ j - l ] )
+				continue;
+
+			diff.mExtra++;
+			if ( diff.mMessages.size() < MAX_MESSAGES )
+			{
+				stringstream msg;
+				msg << "frame " << frame << ": extra " << typeToString( mEntries[ j ].mType ) <<
+					" event of blob " << mEntries[ j ].mId;
+				diff.mMessages.push_back( msg.str() );
+			}
+		}
+
+		g = gEnd;
+		l = lEnd;
+	}
+
+	return diff;
+}
+
+} // namespace mndl
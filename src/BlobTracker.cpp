@@ -19,9 +19,9 @@
  https://github.com/patriciogonzalezvivo/ofxBlobTracker
 */
 
+#include <float.h>
+
 #include <boost/assign.hpp>
-#include <list>
-#include <map>
 
 #include "cinder/app/App.h"
 #include "cinder/Area.h"
@@ -29,6 +29,9 @@
 
 #include "BlobTracker.h"
 #include "CinderOpenCV.h"
+#include "SessionReplay.h"
+#include "TrackerBenchmark.h"
+#include "TransportBenchmark.h"
 #include "Utils.h"
 
 using namespace ci;
@@ -36,7 +39,44 @@ using namespace std;
 
 namespace mndl {
 
-void BlobTracker::setup()
+BlobTracker::BlobTracker() :
+	mSavingVideo( false ),
+	mDrawCapture( DRAW_NONE ),
+	mIdCounter( 1 ),
+	mCoastFrames( 3 ),
+	mCoastMs( 100 ),
+	mCoastDistance( 0.05f ),
+	mReconnectionCount( 0 ),
+	mCoastExpiredCount( 0 ),
+	mMergeTolerance( .35f ),
+	mMergeCount( 0 ),
+	mSplitCount( 0 ),
+	mTuioOutput( false ),
+	mTuioPort( 3333 ),
+	mTuioVersion( TuioSender::TUIO_1_1 ),
+	mChannelOutput( false ),
+	mChannelOpenTime( -1. ),
+	mChannelDroppedFrames( 0 ),
+	mThreadedTracking( false ),
+	mTrackingThreadRunning( false ),
+	mQueueEvents( false ),
+	mTrackingFps( 0.f ),
+	mNumQueuedFrames( 0 ),
+	mNumDrainedFrames( 0 )
+{
+	// preallocate per frame tracking storage
+	mNewBlobs.reserve( 64 );
+	mBlobOwners.reserve( 64 );
+	mBlobOwnerAreas.reserve( 64 );
+	mBlobShares.reserve( 64 );
+	mTrackWinners.reserve( 64 );
+	mBeganEvents.reserve( 64 );
+	mMovedEvents.reserve( 64 );
+	mEndedEvents.reserve( 64 );
+	mFrameEvents.reserve( 3 * 64 );
+}
+
+void BlobTracker::setup( const Rectf &calibrationRect )
 {
 	// capture
 
@@ -76,7 +116,7 @@ void BlobTracker::setup()
 		mCaptures.push_back( CaptureParams() );
 	}
 
-	mCalibratorRef = shared_ptr< ManualCalibration >( new ManualCalibration( this ) );
+	mCalibratorRef = shared_ptr< ManualCalibration >( new ManualCalibration( this, calibrationRect ) );
 
 	CaptureParams::setup();
 
@@ -91,7 +131,7 @@ void BlobTracker::setupGui()
 	params::PInterfaceGl::save();
 	mParams.clear();
 
-	vector< string > enumNames = boost::assign::list_of("Recording")("Camera");
+	vector< string > enumNames = boost::assign::list_of("Recording")("Camera")("TUIO")("Shared memory");
 	mParams.addPersistentParam( "Source", enumNames, &mSource, SOURCE_CAMERA );
 
 	if ( mSource == SOURCE_CAMERA )
@@ -102,12 +142,46 @@ void BlobTracker::setupGui()
 		mParams.addSeparator();
 
 		mParams.addButton( "Save video", std::bind( &BlobTracker::saveVideoCB, this ) );
+		mParams.addPersistentParam( "Camera rate tracking", &mThreadedTracking, false );
+		mParams.addParam( "Tracking fps", &mTrackingFps, "", true );
+	}
+	else
+	if ( mSource == SOURCE_TUIO )
+	{
+		mParams.addPersistentParam( "TUIO port", &mTuioPort, 3333, "min=1 max=65535" );
+	}
+	else
+	if ( mSource == SOURCE_SHARED_MEMORY )
+	{
+		mParams.addPersistentParam( "Channel name", &mChannelName, "/irpaint-blobs" );
+		mParams.addParam( "Dropped frames", &mChannelDroppedFrames, "", true );
 	}
 	else
 	{
 		mParams.addSeparator();
 	    mParams.addButton( "Play video", std::bind( &BlobTracker::playVideoCB, this ) );
+		mParams.addButton( "Replay sessions", std::bind( &BlobTracker::replaySessionsCB, this, false ) );
+		mParams.addButton( "Record golden logs", std::bind( &BlobTracker::replaySessionsCB, this, true ) );
+		mParams.addPersistentParam( "Replay tolerance", &mReplayTolerance, 0.002f, "min=0.0 max=0.1 step=0.0005" );
+	}
+
+	if ( mSource != SOURCE_TUIO )
+	{
+		mParams.addSeparator();
+		mParams.addPersistentParam( "TUIO output", &mTuioOutput, false );
+		mParams.addPersistentParam( "TUIO host", &mTuioHost, "127.0.0.1" );
+		mParams.addPersistentParam( "TUIO port", &mTuioPort, 3333, "min=1 max=65535" );
+		enumNames = boost::assign::list_of("1.1")("2.0");
+		mParams.addPersistentParam( "TUIO version", enumNames, &mTuioVersion, TuioSender::TUIO_1_1 );
+	}
+
+	if ( mSource != SOURCE_SHARED_MEMORY )
+	{
+		mParams.addSeparator();
+		mParams.addPersistentParam( "Shared memory output", &mChannelOutput, false );
+		mParams.addPersistentParam( "Channel name", &mChannelName, "/irpaint-blobs" );
 	}
+	mParams.addButton( "Transport benchmark", std::bind( &BlobTracker::transportBenchmarkCB, this ) );
 
 	mParams.addSeparator();
 
@@ -119,6 +193,21 @@ void BlobTracker::setupGui()
 	mParams.addPersistentParam( "Min area", &mMinArea, 0.0001f, "min=0.0 max=1.0 step=0.0001" );
 	mParams.addPersistentParam( "Max area", &mMaxArea, 0.2f, "min=0.0 max=1.0 step=0.001" );
 
+	mParams.addSeparator();
+	mParams.addText( "Coasting" );
+	mParams.addPersistentParam( "Coast frames", &mCoastFrames, 3, "min=0 max=60" );
+	mParams.addPersistentParam( "Coast ms", &mCoastMs, 100, "min=0 max=2000 step=10" );
+	mParams.addPersistentParam( "Coast distance", &mCoastDistance, 0.05f, "min=0.0 max=1.0 step=0.005" );
+	mParams.addParam( "Reconnections", &mReconnectionCount, "", true );
+	mParams.addParam( "Expired coasts", &mCoastExpiredCount, "", true );
+
+	mParams.addSeparator();
+	mParams.addText( "Merging" );
+	mParams.addPersistentParam( "Merge area tolerance", &mMergeTolerance, .35f, "min=0.0 max=1.0 step=0.01" );
+	mParams.addParam( "Merges", &mMergeCount, "", true );
+	mParams.addParam( "Splits", &mSplitCount, "", true );
+	mParams.addButton( "Run benchmark", std::bind( &BlobTracker::benchmarkCB, this ) );
+
 	mParams.addSeparator();
 	mParams.addText( "Debug" );
 
@@ -141,6 +230,11 @@ void BlobTracker::update()
 		lastSource = mSource;
 	}
 
+	// camera frames are processed in the tracking thread if enabled
+	bool threaded = ( mSource == SOURCE_CAMERA ) && mThreadedTracking;
+	if ( !threaded || ( lastCapture != mCurrentCapture ) )
+		stopTrackingThread();
+
 	// select source
 	bool processFrame = false;
 	Surface8u inputSurface;
@@ -166,13 +260,60 @@ void BlobTracker::update()
 			lastCapture = mCurrentCapture;
 		}
 
-		if ( resetParams )
-			mCapture.buildParams();
+		// the capture is polled by the tracking thread if it is running
+		{
+			lock_guard< mutex > lock( mTrackingMutex );
+			if ( resetParams )
+				mCapture.buildParams();
+			else
+				mCapture.updateParams();
+		}
+
+		if ( threaded )
+		{
+			if ( !mTrackingThread && mCapture )
+				startTrackingThread();
+		}
 		else
-			mCapture.updateParams();
+		{
+			processFrame = mCapture && mCapture.checkNewFrame();
+			inputSurface = mCapture.getSurface();
+		}
+	}
+	else
+	if ( mSource == SOURCE_TUIO )
+	{
+		// stop capture device
+		if ( lastCapture != -1 )
+		{
+			mCaptures[ lastCapture ].stop();
+			lastCapture = -1;
+		}
 
-		processFrame = mCapture && mCapture.checkNewFrame();
-		inputSurface = mCapture.getSurface();
+		if ( mTuioReceiver.getPort() != mTuioPort )
+			mTuioReceiver.open( mTuioPort );
+
+		// received blobs are already tracked and normalized
+		while ( mTuioReceiver.popFrame( &mNewBlobs ) )
+			mirrorBlobs( mNewBlobs, app::getElapsedSeconds() );
+	}
+	else
+	if ( mSource == SOURCE_SHARED_MEMORY )
+	{
+		// stop capture device
+		if ( lastCapture != -1 )
+		{
+			mCaptures[ lastCapture ].stop();
+			lastCapture = -1;
+		}
+
+		updateBlobChannel();
+
+		// every frame published by the detection process is mirrored
+		double frameTime;
+		while ( mBlobChannel.read( &mNewBlobs, &frameTime ) )
+			mirrorBlobs( mNewBlobs, app::getElapsedSeconds() );
+		mChannelDroppedFrames = mBlobChannel.getDroppedFrames();
 	}
 	else // SOURCE_RECORDING
 	if ( mMovie )
@@ -192,284 +333,632 @@ void BlobTracker::update()
 		inputSurface = mMovie.getSurface();
 	}
 
+	if ( ( mSource != SOURCE_TUIO ) && mTuioReceiver.isOpen() )
+		mTuioReceiver.close();
+
+	// the rest of the tracker state is shared with the tracking thread
+	DebugChannels debugChannels;
+	{
+		lock_guard< mutex > lock( mTrackingMutex );
+
+		// tuio output, not available if the blobs are received from tuio
+		if ( mTuioOutput && ( mSource != SOURCE_TUIO ) )
+		{
+			if ( ( mTuioSender.getHost() != mTuioHost ) || ( mTuioSender.getPort() != mTuioPort ) )
+			{
+				mTuioSender.setDimension( CAPTURE_WIDTH, CAPTURE_HEIGHT );
+				mTuioSender.open( mTuioHost, mTuioPort );
+			}
+			mTuioSender.setVersion( (TuioSender::Version)mTuioVersion );
+		}
+		else
+		{
+			mTuioSender.close();
+		}
+
+		if ( mSource != SOURCE_SHARED_MEMORY )
+			updateBlobChannel();
+
+		mDetectionSettings = getDetectionSettings();
+
+		// take over the results of the tracking thread, they are handled
+		// after unlocking, so the callbacks and the texture uploads do not
+		// stall the tracking thread
+		mQueuedFrames.swap( mDrainedFrames );
+		mNumDrainedFrames = mNumQueuedFrames;
+		mNumQueuedFrames = 0;
+		mSavedFrames.swap( mDrainedSavedFrames );
+		if ( threaded )
+		{
+			mDrainedTracks = mPublishedTracks;
+			debugChannels = mQueuedDebugChannels;
+			mQueuedDebugChannels.mUpdated = false;
+		}
+	}
+
+	if ( mSavingVideo )
+	{
+		for ( vector< Surface8u >::const_iterator it = mDrainedSavedFrames.begin(); it != mDrainedSavedFrames.end(); ++it )
+			mMovieWriter.addFrame( *it );
+	}
+	mDrainedSavedFrames.clear();
+
 	// process source image
 	if ( processFrame )
 	{
 		if ( mSavingVideo )
 			mMovieWriter.addFrame( inputSurface );
 
-		// opencv
-		cv::Mat input( toOcv( Channel8u( inputSurface ) ) );
-		if ( mFlip )
-			cv::flip( input, input, 1 );
-		cv::Mat blurred, thresholded;
+		detectBlobs( inputSurface, getDetectionSettings(), app::getElapsedSeconds() );
+	}
 
-		cv::blur( input, blurred, cv::Size( mBlurSize, mBlurSize ) );
-		cv::threshold( blurred, thresholded, mThreshold, 255, CV_THRESH_BINARY );
+	// the debug images are written by the tracking thread if it is running
+	if ( !threaded )
+	{
+		debugChannels = mDebugChannels;
+		mDebugChannels.mUpdated = false;
+	}
+	if ( debugChannels.mUpdated )
+	{
+		mTextureOrig = gl::Texture( debugChannels.mOrig );
+		mTextureBlurred = gl::Texture( debugChannels.mBlurred );
+		mTextureThresholded = gl::Texture( debugChannels.mThresholded );
+	}
 
-		mTextureOrig = gl::Texture( fromOcv( input ) );
-		mTextureBlurred = gl::Texture( fromOcv( blurred ) );
-		mTextureThresholded = gl::Texture( fromOcv( thresholded ) );
+	// all intermediate frames are delivered in order with their camera timestamps
+	fireQueuedEvents();
 
-		vector< vector< cv::Point > > contours;
-		cv::findContours( thresholded, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE );
+	mCalibratorRef->update();
+}
+
+//! Returns the current detection parameters.
+BlobTracker::DetectionSettings BlobTracker::getDetectionSettings() const
+{
+	DetectionSettings settings;
+	settings.mFlip = mFlip;
+	settings.mThreshold = mThreshold;
+	settings.mBlurSize = mBlurSize;
+	settings.mMinArea = mMinArea;
+	settings.mMaxArea = mMaxArea;
+	settings.mDrawCapture = mDrawCapture;
+	settings.mNormMapping = mNormMapping;
+	return settings;
+}
+
+/** Detects the blobs in \a inputSurface and tracks them.
+ *  \param now time of the frame in seconds **/
+void BlobTracker::detectBlobs( const Surface8u &inputSurface, const DetectionSettings &settings, double now )
+{
+	// opencv
+	cv::Mat input( toOcv( Channel8u( inputSurface ) ) );
+	if ( settings.mFlip )
+		cv::flip( input, input, 1 );
+	cv::Mat blurred, thresholded;
+
+	cv::blur( input, blurred, cv::Size( settings.mBlurSize, settings.mBlurSize ) );
+	cv::threshold( blurred, thresholded, settings.mThreshold, 255, CV_THRESH_BINARY );
+
+	// debug images are only needed if they are drawn, the textures are
+	// created in update(), this may run in the tracking thread
+	if ( settings.mDrawCapture != DRAW_NONE )
+	{
+		mDebugChannels.mOrig = Channel8u( fromOcv( input ) );
+		mDebugChannels.mBlurred = Channel8u( fromOcv( blurred ) );
+		mDebugChannels.mThresholded = Channel8u( fromOcv( thresholded ) );
+		mDebugChannels.mUpdated = true;
+	}
 
-		float surfArea = inputSurface.getWidth() * inputSurface.getHeight();
-		float minAreaLimit = surfArea * mMinArea;
-		float maxAreaLimit = surfArea * mMaxArea;
+	vector< vector< cv::Point > > contours;
+	cv::findContours( thresholded, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE );
 
-		vector< BlobRef > newBlobs;
-		for ( vector< vector< cv::Point > >::iterator cit = contours.begin(); cit < contours.end(); ++cit )
+	float surfArea = inputSurface.getWidth() * inputSurface.getHeight();
+	float minAreaLimit = surfArea * settings.mMinArea;
+	float maxAreaLimit = surfArea * settings.mMaxArea;
+
+	mNewBlobs.clear();
+	for ( vector< vector< cv::Point > >::iterator cit = contours.begin(); cit < contours.end(); ++cit )
+	{
+		Blob b;
+		cv::Mat pmat = cv::Mat( *cit );
+		cv::Rect cvRect = cv::boundingRect( pmat );
+		b.mBbox = Rectf( cvRect.x, cvRect.y,
+						cvRect.x + cvRect.width, cvRect.y + cvRect.height );
+		float area = b.mBbox.calcArea();
+		if ( ( minAreaLimit <= area ) && ( area < maxAreaLimit ) )
 		{
-			BlobRef b = BlobRef( new Blob() );
-			cv::Mat pmat = cv::Mat( *cit );
-			cv::Rect cvRect = cv::boundingRect( pmat );
-			b->mBbox = Rectf( cvRect.x, cvRect.y,
-							cvRect.x + cvRect.width, cvRect.y + cvRect.height );
-			float area = b->mBbox.calcArea();
-			if ( ( minAreaLimit <= area ) && ( area < maxAreaLimit ) )
-			{
-				cv::Moments m = cv::moments( pmat );
-				b->mCentroid = Vec2f( m.m10 / m.m00, m.m01 / m.m00 );
+			cv::Moments m = cv::moments( pmat );
+			b.mCentroid = Vec2f( m.m10 / m.m00, m.m01 / m.m00 );
+			b.mArea = m.m00 / surfArea;
 
-				b->mBbox = mNormMapping.map( b->mBbox );
-				b->mCentroid = b->mPrevCentroid = mNormMapping.map( b->mCentroid );
-				newBlobs.push_back( b );
-			}
+			b.mBbox = settings.mNormMapping.map( b.mBbox );
+			b.mCentroid = b.mPrevCentroid = settings.mNormMapping.map( b.mCentroid );
+			mNewBlobs.push_back( b );
 		}
-
-		trackBlobs( newBlobs );
 	}
 
-	mCalibratorRef->update();
+	trackBlobs( mNewBlobs, now );
 }
 
-void BlobTracker::trackBlobs( vector< BlobRef > newBlobs )
+void BlobTracker::trackBlobs( const vector< Blob > &newBlobs, double now )
 {
-	// all new blob id's initialized with -1
+	// all new blobs are unclaimed, all tracks are unmatched
+	mBlobOwners.assign( newBlobs.size(), -1 );
+	mBlobOwnerAreas.assign( newBlobs.size(), 0.f );
+	mTrackWinners.assign( mTracks.size(), -1 );
+
+	mBeganEvents.clear();
+	mMovedEvents.clear();
+	mEndedEvents.clear();
 
-	// step 1: match new blobs with existing nearest ones
-	for ( size_t i = 0; i < mBlobs.size(); i++ )
+	// step 1: match new blobs with the ones nearest to the predicted positions
+	for ( size_t i = 0; i < mTracks.size(); i++ )
 	{
-		int32_t winner = findClosestBlobKnn( newBlobs, mBlobs[ i ], 3, 0 );
+		Vec2f pos = mTracks.getPredictedCentroid( i );
+		int32_t winner = findClosestBlob( newBlobs, pos, false );
+
+		// coasting blobs are only reconnected to nearby blobs, otherwise
+		// a lost pen would steal the blob of a pen appearing elsewhere
+		if ( ( winner != -1 ) && mTracks.isCoasting( i ) &&
+			 ( newBlobs[ winner ].mCentroid.distanceSquared( pos ) >
+			   mCoastDistance * mCoastDistance ) )
+		{
+			winner = -1;
+		}
 
-		if ( winner == -1 ) // track has died
+		if ( winner == -1 ) // track is lost in this frame
+			continue;
+
+		int32_t j = mBlobOwners[ winner ];
+		if ( j == -1 ) // no conflicts, so simply update
 		{
-			mBlobsEndedSig( BlobEvent( mBlobs[ i ] ) );
-			mBlobs[ i ]->mId = -1; // marked for deletion
+			mBlobOwners[ winner ] = i;
+			mBlobOwnerAreas[ winner ] = mTracks.getArea( i );
+			mTrackWinners[ i ] = winner;
+			continue;
 		}
-		else
+
+		// if the area of the blob claimed by more tracks is about the sum of
+		// the track areas, touching pens merged into one blob, the tracks share it
+		if ( isMerge( newBlobs[ winner ].mArea, mBlobOwnerAreas[ winner ], mTracks.getArea( i ) ) )
 		{
-			// if winning new blob was labeled winner by another track
-			// then compare with this track to see which is closer
-			if ( newBlobs[ winner ]->mId != -1 )
-			{
-				// find the currently assigned blob
-				int j; // j will be the index of it
-				for ( j = 0; j < mBlobs.size(); j++ )
-				{
-					if ( mBlobs[ j ]->mId == newBlobs[ winner ]->mId )
-						break;
-				}
-
-				if ( j == mBlobs.size() ) // got to end without finding it
-				{
-					newBlobs[ winner ]->mId = mBlobs[ i ]->mId;
-					mBlobs[ i ] = newBlobs[ winner ];
-				}
-				else // found it, compare with current blob
-				{
-					Vec2f p = newBlobs[ winner ]->mCentroid;
-					Vec2f pOld = mBlobs[ j ]->mCentroid;
-					Vec2f pNew = mBlobs[ i ]->mCentroid;
-					float distOld = p.distanceSquared( pOld );
-					float distNew = p.distanceSquared( pNew );
-
-					// if this track is closer, update the Id of the blob
-					// otherwise delete this track.. it's dead
-					if ( distNew < distOld ) // update
-					{
-						newBlobs[ winner ]->mId = mBlobs[ i ]->mId;
-						/* TODO
-						   now the old winning blob has lost the win.
-						   I should also probably go through all the newBlobs
-						   at the end of this loop and if there are ones without
-						   any winning matches, check if they are close to this
-						   one. Right now I'm not doing that to prevent a
-						   recursive mess. It'll just be a new track.
-						 */
-						mBlobsEndedSig( BlobEvent( mBlobs[ j ] ) );
-						// mark the blob for deletion
-						mBlobs[ j ]->mId = -1;
-					}
-					else // delete
-					{
-						mBlobsEndedSig( BlobEvent( mBlobs[ i ] ) );
-						// mark the blob for deletion
-						mBlobs[ i ]->mId = -1;
-					}
-				}
-			}
-			else // no conflicts, so simply update
+			mBlobOwnerAreas[ winner ] += mTracks.getArea( i );
+			mTrackWinners[ i ] = winner;
+			continue;
+		}
+
+		// otherwise the closer track takes over the blob,
+		// the others are matched again in step 2
+		Vec2f p = newBlobs[ winner ].mCentroid;
+		float distOld = p.distanceSquared( mTracks.getPredictedCentroid( j ) );
+		float distNew = p.distanceSquared( pos );
+		if ( distNew < distOld )
+		{
+			for ( size_t k = 0; k < i; k++ )
 			{
-				newBlobs[ winner ]->mId = mBlobs[ i ]->mId;
+				if ( mTrackWinners[ k ] == winner )
+					mTrackWinners[ k ] = -1;
 			}
+			mBlobOwners[ winner ] = i;
+			mBlobOwnerAreas[ winner ] = mTracks.getArea( i );
+			mTrackWinners[ i ] = winner;
+		}
+	}
+
+	// step 2: tracks losing their blob in step 1 are matched with the
+	// nearby unclaimed blobs. when a merged blob splits, the track not
+	// getting the nearest part continues with the other one instead of
+	// ending and starting a new track.
+	for ( size_t i = 0; i < mTracks.size(); i++ )
+	{
+		if ( mTrackWinners[ i ] != -1 )
+			continue;
+
+		Vec2f pos = mTracks.getPredictedCentroid( i );
+		int32_t winner = findClosestBlob( newBlobs, pos, true );
+		if ( ( winner != -1 ) &&
+			 ( newBlobs[ winner ].mCentroid.distanceSquared( pos ) <=
+			   mCoastDistance * mCoastDistance ) )
+		{
+			mBlobOwners[ winner ] = i;
+			mBlobOwnerAreas[ winner ] = mTracks.getArea( i );
+			mTrackWinners[ i ] = winner;
 		}
 	}
 
-	// step 2: blob update
+	// number of tracks sharing each blob
+	mBlobShares.assign( newBlobs.size(), 0 );
+	for ( size_t i = 0; i < mTracks.size(); i++ )
+	{
+		if ( mTrackWinners[ i ] != -1 )
+			mBlobShares[ mTrackWinners[ i ] ]++;
+	}
+
+	// step 3: blob update
 	//
-	// update all current tracks
-	// remove every track labeled as dead, id = -1
-	// find every track that's alive and copy its data from newBlobs
-	for ( size_t i = 0; i < mBlobs.size(); i++ )
+	// update all current tracks from their matched new blobs
+	// keep unmatched tracks coasting and remove the ones that are lost
+	// for longer than the grace period. removal moves the last track to
+	// the place of the removed one, so the index is not advanced then.
+	size_t i = 0;
+	while ( i < mTracks.size() )
 	{
-		if ( mBlobs[ i ]->mId == -1 ) // dead
+		int32_t winner = mTrackWinners[ i ];
+		if ( winner != -1 ) // living, so update its data
 		{
-			// erase track
-			mBlobs.erase( mBlobs.begin() + i, mBlobs.begin() + i + 1 );
-			i--; // decrement one since we removed an element
+			if ( mTracks.isCoasting( i ) )
+				mReconnectionCount++;
+
+			if ( mBlobShares[ winner ] > 1 )
+			{
+				if ( !mTracks.isMerged( i ) )
+					mMergeCount++;
+				mTracks.merge( i, newBlobs[ winner ], now );
+			}
+			else
+			{
+				if ( mTracks.isMerged( i ) )
+					mSplitCount++;
+				mTracks.update( i, newBlobs[ winner ], now );
+			}
+
+			Vec2f tD = mTracks.getCentroid( i ) - mTracks.getPrevCentroid( i );
+
+			// calculate the acceleration
+			float posDelta = tD.length();
+
+			// a jump farther than a lost pen is reconnected from is a
+			// reassignment rather than motion, it is not extrapolated
+			if ( posDelta > mCoastDistance )
+				mTracks.clearVelocity( i );
+			if ( posDelta > 0.001 )
+			{
+				mMovedEvents.push_back( BlobEvent( mTracks.getBlob( i ), BlobEvent::BLOB_MOVED, now ) );
+			}
+
+			// TODO: add other blob features
 		}
-		else // living, so update its data
+		else // lost, coast until the grace period runs out
 		{
-			for ( int j = 0; j < newBlobs.size(); j++ )
+			mTracks.miss( i );
+			double lostMs = ( now - mTracks.getLastSeen( i ) ) * 1000.;
+
+			if ( ( mTracks.getMissedFrames( i ) > mCoastFrames ) ||
+				 ( lostMs > mCoastMs ) )
 			{
-				if ( mBlobs[ i ]->mId == newBlobs[ j ]->mId )
-				{
-					// update track
-					// store the last centroid
-					newBlobs[ j ]->mPrevCentroid = mBlobs[ i ]->mCentroid;
-					mBlobs[ i ] = newBlobs[ j ];
-
-					Vec2f tD = mBlobs[ i ]->mCentroid - mBlobs[ i ]->mPrevCentroid;
-
-					// calculate the acceleration
-					float posDelta = tD.length();
-					if ( posDelta > 0.001 )
-					{
-						mBlobsMovedSig( BlobEvent( mBlobs[ i ] ) );
-					}
-
-					// TODO: add other blob features
-				}
+				// only tracks that survived at least one missed frame coasted,
+				// without a grace period every loss ends the track at once
+				if ( ( mCoastFrames > 0 ) && ( mCoastMs > 0 ) &&
+					 ( mTracks.getMissedFrames( i ) > 1 ) )
+					mCoastExpiredCount++;
+
+				mEndedEvents.push_back( BlobEvent( mTracks.getBlob( i ), BlobEvent::BLOB_ENDED, now ) );
+
+				// erase track
+				mTrackWinners[ i ] = mTrackWinners.back();
+				mTrackWinners.pop_back();
+				mTracks.removeAt( i );
+				continue;
 			}
 		}
+		i++;
 	}
 
-	// step 3: add tracked blobs to touchevents
+	// step 4: add tracked blobs to touchevents
 	// -- add new living tracks
-	// now every new blob should be either labeled with a tracked id or
-	// have id of -1. if the id is -1, we need to make a new track.
-	for ( size_t i = 0; i < newBlobs.size(); i++ )
+	// now every new blob should be either claimed by a track or
+	// unclaimed. if it is unclaimed, we need to make a new track.
+	for ( size_t j = 0; j < newBlobs.size(); j++ )
 	{
-		if ( newBlobs[ i ]->mId == -1 )
+		if ( mBlobOwners[ j ] == -1 )
 		{
 			// add new track
-			newBlobs[ i ]->mId = mIdCounter;
+			Blob b = newBlobs[ j ];
+			b.mId = mIdCounter;
 			mIdCounter++;
 
-			mBlobs.push_back( newBlobs[ i ] );
+			mTracks.add( b, now );
 
-			mBlobsBeganSig( BlobEvent( newBlobs[ i ] ) );
+			mBeganEvents.push_back( BlobEvent( b, BlobEvent::BLOB_BEGAN, now ) );
 		}
 	}
+
+	dispatchEvents( now );
 }
 
-/** Finds the blob in newBlobs that is closest to the blob \a track.
- * \param newBlobs list of blobs detected in the last frame
- * \param track current blob
- * \param k number of nearest neighbours, must be odd number (1, 3, 5 are common)
- * \param thres optimization threshold
- * Returns the closest blob id if found or -1
- */
-int32_t BlobTracker::findClosestBlobKnn( const vector< BlobRef > &newBlobs, BlobRef track,
-		int k, double thresh )
+/** Takes over the blobs of a remote tracker as they are. The ids are kept,
+ *  blobs missing from \a blobs end, blobs with unknown ids begin. **/
+void BlobTracker::mirrorBlobs( const vector< Blob > &blobs, double now )
 {
-	int32_t winner = -1;
-	if ( thresh > 0. )
-		thresh *= thresh;
+	mBeganEvents.clear();
+	mMovedEvents.clear();
+	mEndedEvents.clear();
+
+	mBlobOwners.assign( blobs.size(), -1 );
 
-	// list of neighbour point index and respective distances
-	list< pair< size_t, double > > nbors;
-	list< pair< size_t, double > >::iterator iter;
+	size_t i = 0;
+	while ( i < mTracks.size() )
+	{
+		int32_t match = -1;
+		for ( size_t j = 0; j < blobs.size(); j++ )
+		{
+			if ( blobs[ j ].mId == mTracks.getId( i ) )
+			{
+				match = j;
+				break;
+			}
+		}
 
-	// find 'k' closest neighbors of testpoint
-	Vec2f p;
-	Vec2f pT = track->mCentroid;
-	float distSquared;
+		if ( match == -1 )
+		{
+			mEndedEvents.push_back( BlobEvent( mTracks.getBlob( i ), BlobEvent::BLOB_ENDED, now ) );
+			mTracks.removeAt( i );
+			continue;
+		}
 
-	// search for blobs
-	for ( size_t i = 0; i < newBlobs.size(); i++ )
+		mBlobOwners[ match ] = i;
+		mTracks.update( i, blobs[ match ], now );
+		if ( mTracks.getCentroid( i ).distance( mTracks.getPrevCentroid( i ) ) > 0.001 )
+			mMovedEvents.push_back( BlobEvent( mTracks.getBlob( i ), BlobEvent::BLOB_MOVED, now ) );
+		i++;
+	}
+
+	for ( size_t j = 0; j < blobs.size(); j++ )
+	{
+		if ( mBlobOwners[ j ] == -1 )
+		{
+			Blob b = blobs[ j ];
+			b.mPrevCentroid = b.mCentroid;
+			mTracks.add( b, now );
+			mBeganEvents.push_back( BlobEvent( b, BlobEvent::BLOB_BEGAN, now ) );
+		}
+	}
+
+	dispatchEvents( now );
+}
+
+/** Delivers the events of the frame. Frame callbacks receive all events
+ *  in one contiguous range sorted by type, the per event callbacks are
+ *  called afterwards for each event. **/
+void BlobTracker::dispatchEvents( double now )
+{
+	mFrameEvents.clear();
+	mFrameEvents.insert( mFrameEvents.end(), mBeganEvents.begin(), mBeganEvents.end() );
+	mFrameEvents.insert( mFrameEvents.end(), mMovedEvents.begin(), mMovedEvents.end() );
+	mFrameEvents.insert( mFrameEvents.end(), mEndedEvents.begin(), mEndedEvents.end() );
+
+	BlobFrameEvent frameEvent( mFrameEvents.empty() ? NULL : &mFrameEvents[ 0 ],
+			mBeganEvents.size(), mMovedEvents.size(), mEndedEvents.size() );
+
+	// results of the tracking thread are delivered on the main thread in
+	// update(), the outputs are configured there
+	if ( mQueueEvents )
+	{
+		lock_guard< mutex > lock( mTrackingMutex );
+		sendEvents( frameEvent, now );
+		queueEvents();
+		return;
+	}
+
+	sendEvents( frameEvent, now );
+	if ( !mFrameEvents.empty() )
+		fireEvents( frameEvent );
+}
+
+//! Sends the tracks of the frame to the tuio and shared memory outputs.
+void BlobTracker::sendEvents( const BlobFrameEvent &event, double now )
+{
+	// tuio sends the alive blobs every frame, even if nothing changed
+	if ( mTuioSender.isOpen() )
+		mTuioSender.send( mTracks, event, now );
+
+	if ( mBlobChannel.isWriter() )
+		mBlobChannel.write( mTracks, now );
+}
+
+//! Hands over the tracks, events and debug images of the frame to update().
+void BlobTracker::queueEvents()
+{
+	mPublishedTracks = mTracks;
+
+	if ( mDebugChannels.mUpdated )
+	{
+		mQueuedDebugChannels = mDebugChannels;
+		mDebugChannels.mUpdated = false;
+	}
+
+	if ( mFrameEvents.empty() )
+		return;
+
+	if ( mNumQueuedFrames == mQueuedFrames.size() )
+		mQueuedFrames.push_back( QueuedFrame() );
+
+	QueuedFrame &frame = mQueuedFrames[ mNumQueuedFrames++ ];
+	frame.mEvents.assign( mFrameEvents.begin(), mFrameEvents.end() );
+	frame.mNumBegan = mBeganEvents.size();
+	frame.mNumMoved = mMovedEvents.size();
+	frame.mNumEnded = mEndedEvents.size();
+}
+
+void BlobTracker::fireEvents( const BlobFrameEvent &event )
+{
+	if ( !mBlobsFrameSig.empty() )
+		mBlobsFrameSig( event );
+
+	// per event adapter
+	if ( !mBlobsBeganSig.empty() )
 	{
-		p = newBlobs[ i ]->mCentroid;
-		distSquared = p.distanceSquared( pT );
+		BlobEventRange began = event.getBegan();
+		for ( BlobEventRange::const_iterator it = began.begin(); it != began.end(); ++it )
+			mBlobsBeganSig( *it );
+	}
+	if ( !mBlobsMovedSig.empty() )
+	{
+		BlobEventRange moved = event.getMoved();
+		for ( BlobEventRange::const_iterator it = moved.begin(); it != moved.end(); ++it )
+			mBlobsMovedSig( *it );
+	}
+	if ( !mBlobsEndedSig.empty() )
+	{
+		BlobEventRange ended = event.getEnded();
+		for ( BlobEventRange::const_iterator it = ended.begin(); it != ended.end(); ++it )
+			mBlobsEndedSig( *it );
+	}
+}
+
+//! Fires the events of the frames taken over from the tracking thread.
+void BlobTracker::fireQueuedEvents()
+{
+	for ( size_t i = 0; i < mNumDrainedFrames; i++ )
+	{
+		const QueuedFrame &frame = mDrainedFrames[ i ];
+		fireEvents( BlobFrameEvent( &frame.mEvents[ 0 ], frame.mNumBegan,
+					frame.mNumMoved, frame.mNumEnded ) );
+	}
+	mNumDrainedFrames = 0;
+}
+
+void BlobTracker::startTrackingThread()
+{
+	// the thread is not running yet, nothing to lock
+	mDetectionSettings = getDetectionSettings();
+	mPublishedTracks = mDrainedTracks = mTracks;
+
+	mQueueEvents = true;
+	mTrackingThreadRunning = true;
+	mTrackingThread = shared_ptr< thread >( new thread( &BlobTracker::trackingThread, this ) );
+}
 
-		if ( distSquared <= thresh )
+void BlobTracker::stopTrackingThread()
+{
+	if ( !mTrackingThread )
+		return;
+
+	mTrackingThreadRunning = false;
+	mTrackingThread->join();
+	mTrackingThread.reset();
+	mQueueEvents = false;
+	mTrackingFps = 0.f;
+}
+
+/** Processes every camera frame as soon as it arrives, independently of
+ *  the frame rate of the application. **/
+void BlobTracker::trackingThread()
+{
+	int frames = 0;
+	double fpsStart = app::getElapsedSeconds();
+
+	while ( mTrackingThreadRunning )
+	{
+		bool newFrame = false;
+		bool saving = false;
+		Surface8u inputSurface;
+		DetectionSettings settings;
 		{
-			winner = i;
-			return winner;
+			// the capture params and the settings are updated by the main thread
+			lock_guard< mutex > lock( mTrackingMutex );
+			if ( mCapture.checkNewFrame() )
+			{
+				newFrame = true;
+				inputSurface = mCapture.getSurface();
+				settings = mDetectionSettings;
+				saving = mSavingVideo;
+			}
 		}
 
-		// check if this blob is closer to the point than what we've seen
-		// so far and add it to the index/distance list if positive
+		if ( !newFrame )
+		{
+			ci::sleep( 1 );
+			continue;
+		}
 
-		// search the list for the first point with a longer distance
-		for ( iter = nbors.begin();
-				iter != nbors.end() && distSquared >= iter->second; ++iter );
+		double now = app::getElapsedSeconds();
 
-		if ( ( iter != nbors.end() ) || ( nbors.size() < k ) )
+		// the movie is written on the main thread, the capture may reuse
+		// the surface until then
+		if ( saving )
 		{
-			nbors.insert( iter, 1, std::pair< size_t, double >( i, distSquared ));
-			// too many items in list, get rid of farthest neighbor
-			if ( nbors.size() > k )
-				nbors.pop_back();
+			Surface8u savedFrame = inputSurface.clone();
+			lock_guard< mutex > lock( mTrackingMutex );
+			mSavedFrames.push_back( savedFrame );
 		}
-	}
 
+		// the results are handed over in dispatchEvents()
+		detectBlobs( inputSurface, settings, now );
 
-	/********************************************************************
-	 * we now have k nearest neighbors who cast a vote, and the majority
-	 * wins. we use each class average distance to the target to break any
-	 * possible ties.
-	 *********************************************************************/
+		frames++;
+		if ( now - fpsStart >= 1. )
+		{
+			mTrackingFps = frames / ( now - fpsStart );
+			frames = 0;
+			fpsStart = now;
+		}
+	}
+}
 
-	// a mapping from labels (IDs) to count/distance
-	map< int32_t, pair< size_t, double > > votes;
+/** Finds the blob in newBlobs that is closest to the position \a pos.
+ * \param newBlobs list of blobs detected in the last frame
+ * \param pos centroid of the current track
+ * Returns the index of the closest blob if found or -1
+ */
+int32_t BlobTracker::findClosestBlob( const vector< Blob > &newBlobs, const Vec2f &pos,
+		bool unclaimedOnly ) const
+{
+	int32_t winner = -1;
+	float winnerDist = FLT_MAX;
 
-	// remember:
-	// iter->first = index of newBlob
-	// iter->second = distance of newBlob to current tracked blob
-	for ( iter = nbors.begin(); iter != nbors.end(); ++iter )
+	for ( size_t i = 0; i < newBlobs.size(); i++ )
 	{
-		// add up how many counts each neighbor got
-		size_t count = ++( votes[ iter->first ].first );
-		double dist = ( votes[ iter->first ].second += iter->second );
+		if ( unclaimedOnly && ( mBlobOwners[ i ] != -1 ) )
+			continue;
 
-		// check for a possible tie and break with distance
-		if ( ( count > votes[ winner ].first ) ||
-				( ( count == votes[ winner ].first ) &&
-				  ( dist < votes[ winner ].second ) ) )
+		float distSquared = newBlobs[ i ].mCentroid.distanceSquared( pos );
+		if ( distSquared < winnerDist )
 		{
-			winner = iter->first;
+			winnerDist = distSquared;
+			winner = i;
 		}
 	}
 
 	return winner;
 }
 
+/** Returns true if a blob with \a blobArea claimed by tracks with a total
+ *  area of \a ownerArea is a merge with the track of \a trackArea.
+ *  Only contour blobs carry an area, blobs without one are never merges.
+ *  TUIO and shared memory blobs have no area but they are mirrored with
+ *  their remote ids and do not reach the matching at all. **/
+bool BlobTracker::isMerge( float blobArea, float ownerArea, float trackArea ) const
+{
+	if ( ( blobArea <= 0.f ) || ( ownerArea <= 0.f ) || ( trackArea <= 0.f ) )
+		return false;
+
+	float mergedArea = ownerArea + trackArea;
+	return math< float >::abs( blobArea - mergedArea ) <= mMergeTolerance * mergedArea;
+}
+
 size_t BlobTracker::getBlobNum() const
 {
-	return mBlobs.size();
+	return getTracks().size();
 }
 
 Rectf BlobTracker::getBlobBoundingRect( size_t i ) const
 {
-	return mBlobs[ i ]->mBbox;
+	return getTracks().getBoundingBox( i );
 }
 
 Vec2f BlobTracker::getBlobCentroid( size_t i ) const
 {
-	return mBlobs[ i ]->mCentroid;
+	return getTracks().getCentroid( i );
+}
+
+int32_t BlobTracker::getBlobId( size_t i ) const
+{
+	return getTracks().getId( i );
+}
+
+bool BlobTracker::isBlobCoasting( size_t i ) const
+{
+	return getTracks().isCoasting( i );
 }
 
 void BlobTracker::draw()
@@ -516,13 +1005,16 @@ void BlobTracker::draw()
 		gl::draw( txt, captureDrawRect );
 
 		RectMapping blobMapping( Rectf( 0, 0, 1, 1 ), captureDrawRect );
-		for ( size_t i = 0; i < mBlobs.size(); ++i )
+		for ( size_t i = 0; i < getBlobNum(); ++i )
 		{
 			Vec2f pos = blobMapping.map( getBlobCentroid( i ) );
-			gl::color( ColorA( 1, 0, 0, .5 ) );
+			if ( isBlobCoasting( i ) )
+				gl::color( ColorA( 1, .8, .1, .5 ) );
+			else
+				gl::color( ColorA( 1, 0, 0, .5 ) );
 			gl::drawStrokedRect( blobMapping.map( getBlobBoundingRect( i ) ) );
 			gl::drawSolidCircle( pos, 2 );
-			gl::drawString( toString< int32_t >( mBlobs[ i ]->mId ), pos + Vec2f( 3, -3 ),
+			gl::drawString( toString< int32_t >( getBlobId( i ) ), pos + Vec2f( 3, -3 ),
 					ColorA( 1, 0, 0, .9 ) );
 		}
 	}
@@ -558,9 +1050,14 @@ void BlobTracker::playVideoCB()
 
 void BlobTracker::saveVideoCB()
 {
+	lock_guard< mutex > lock( mTrackingMutex );
+
 	if ( mSavingVideo )
 	{
 		mParams.setOptions( "Save video", "label=`Save video`" );
+		for ( vector< Surface8u >::const_iterator it = mSavedFrames.begin(); it != mSavedFrames.end(); ++it )
+			mMovieWriter.addFrame( *it );
+		mSavedFrames.clear();
 		mMovieWriter.finish();
 	}
 	else
@@ -583,10 +1080,82 @@ void BlobTracker::saveVideoCB()
 	mSavingVideo = !mSavingVideo;
 }
 
+void BlobTracker::copyTrackingSettings( const BlobTracker &config )
+{
+	mFlip = config.mFlip;
+	mThreshold = config.mThreshold;
+	mBlurSize = config.mBlurSize;
+	mMinArea = config.mMinArea;
+	mMaxArea = config.mMaxArea;
+	mCoastFrames = config.mCoastFrames;
+	mCoastMs = config.mCoastMs;
+	mCoastDistance = config.mCoastDistance;
+	mMergeTolerance = config.mMergeTolerance;
+}
+
+void BlobTracker::replaySessionsCB( bool record )
+{
+	fs::path appPath( app::getAppPath() );
+#ifdef CINDER_MAC
+	appPath /= "..";
+#endif
+	fs::path folder = app::getFolderPath( appPath );
+	if ( folder.empty() )
+		return;
+
+	vector< SessionReplay::Result > results = SessionReplay::run( *this, folder, mReplayTolerance, record );
+	SessionReplay::print( results, app::console() );
+}
+
+void BlobTracker::benchmarkCB()
+{
+	vector< TrackerBenchmark::Result > results = TrackerBenchmark::run( *this );
+	TrackerBenchmark::print( results, app::console() );
+}
+
+void BlobTracker::transportBenchmarkCB()
+{
+	vector< TransportBenchmark::Result > results = TransportBenchmark::run();
+	TransportBenchmark::print( results, app::console() );
+}
+
 void BlobTracker::shutdown()
 {
+	stopTrackingThread();
+
 	if ( mCapture )
 		mCapture.stop();
+
+	mTuioSender.close();
+	mTuioReceiver.close();
+	mBlobChannel.close();
+}
+
+/** Opens the shared memory channel for reading if it is the source,
+ *  for writing if the output is enabled. Failed opens are retried
+ *  every second, the reader waits for the detection process this way. **/
+void BlobTracker::updateBlobChannel()
+{
+	bool reader = ( mSource == SOURCE_SHARED_MEMORY );
+	if ( !reader && !mChannelOutput )
+	{
+		mBlobChannel.close();
+		return;
+	}
+
+	if ( mBlobChannel.isOpen() && ( mBlobChannel.isWriter() != reader ) &&
+		 ( mBlobChannel.getName() == mChannelName ) )
+		return;
+
+	double now = app::getElapsedSeconds();
+	if ( now - mChannelOpenTime < 1. )
+		return;
+
+	mChannelOpenTime = now;
+	if ( reader )
+		mBlobChannel.openReader( mChannelName );
+	else
+		mBlobChannel.openWriter( mChannelName );
 }
 
 } // namspace mndl
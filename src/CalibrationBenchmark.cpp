@@ -0,0 +1,493 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <float.h>
+
+#include <iomanip>
+
+#include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+#include "cinder/Timer.h"
+
+#include "CalibrationBenchmark.h"
+#include "ManualCalibration.h"
+#include "TriangleBatch.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+// number of pens drawn in each frame
+static const size_t PENS = 4;
+// half size of the generated bounding boxes
+static const float BLOB_SIZE = .01f;
+// allowed distance of the lookup table mapping from the exact mapping
+// relative to the output size, about a pixel
+static const float LUT_TOLERANCE = 1e-3f;
+// allowed distance error of the triangle queries
+static const double TRIANGLE_TOLERANCE = 1e-5;
+// allowed relative error of the barycentric coordinates
+static const double BARYCENTRIC_TOLERANCE = 1e-4;
+// barycentric coordinates are only compared on triangles larger than this
+static const float MIN_CONDITIONED_AREA = 1e-3f;
+
+vector< CalibrationBenchmark::Result > CalibrationBenchmark::run( ManualCalibration &calibration, size_t frames )
+{
+	size_t pointsPerFrame;
+	vector< Vec2f > points = generatePoints( frames, &pointsPerFrame );
+	vector< Vec2f > exact( points.size() );
+	vector< Vec2f > reference( points.size() );
+	vector< Vec2f > mapped( points.size() );
+	vector< Result > results;
+	Timer timer;
+
+	Result r;
+	r.mPoints = points.size();
+
+	timer.start();
+	for ( size_t i = 0; i < points.size(); i++ )
+		exact[ i ] = calibration.mapExact( points[ i ] );
+	timer.stop();
+	r.mMethod = "mapExact";
+	r.mNsPerPoint = timer.getSeconds() * 1e9 / points.size();
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < points.size(); i++ )
+		reference[ i ] = calibration.map( points[ i ] );
+	timer.stop();
+	r.mMethod = "map";
+	r.mNsPerPoint = timer.getSeconds() * 1e9 / points.size();
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < points.size(); i += pointsPerFrame )
+		calibration.map( &points[ i ], &mapped[ i ], pointsPerFrame );
+	timer.stop();
+	r.mMethod = "batch map";
+	r.mNsPerPoint = timer.getSeconds() * 1e9 / points.size();
+	results.push_back( r );
+
+	// the lookup table is only checked inside the calibration grid, outside
+	// of it the closest triangles extrapolate and the mapping is not continuous
+	vector< uint8_t > inGrid( points.size() );
+	for ( size_t i = 0; i < points.size(); i++ )
+		inGrid[ i ] = calibration.mCameraLocator.locate( points[ i ] ) >= 0;
+	float tolerance = LUT_TOLERANCE * math< float >::max( calibration.mOutputRect.getWidth(),
+			calibration.mOutputRect.getHeight() );
+
+	compare( exact, exact, reference, NULL, 0.f, &results[ 0 ] );
+	compare( reference, exact, reference, &inGrid, tolerance, &results[ 1 ] );
+	compare( mapped, exact, reference, &inGrid, tolerance, &results[ 2 ] );
+
+	// the models mapExact chooses from
+	timer.start();
+	for ( size_t i = 0; i < points.size(); i++ )
+		mapped[ i ] = calibration.mapTriangles( points[ i ] );
+	timer.stop();
+	r.mMethod = "mapTriangles";
+	r.mNsPerPoint = timer.getSeconds() * 1e9 / points.size();
+	compare( mapped, exact, reference, NULL, 0.f, &r );
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < points.size(); i++ )
+		mapped[ i ] = calibration.mapHomography( points[ i ] );
+	timer.stop();
+	r.mMethod = "mapHomography";
+	r.mNsPerPoint = timer.getSeconds() * 1e9 / points.size();
+	compare( mapped, exact, reference, NULL, 0.f, &r );
+	results.push_back( r );
+	return results;
+}
+
+void CalibrationBenchmark::print( const vector< Result > &results, ostream &out )
+{
+	out << setw( 16 ) << left << "method" << right <<
+		setw( 10 ) << "points" << setw( 10 ) << "ns/point" <<
+		setw( 12 ) << "max error" << setw( 12 ) << "mismatches" << setw( 10 ) << "failures" << endl;
+
+	for ( vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		out << setw( 16 ) << left << it->mMethod << right <<
+			setw( 10 ) << it->mPoints <<
+			setw( 10 ) << fixed << setprecision( 1 ) << it->mNsPerPoint <<
+			setw( 12 ) << scientific << setprecision( 2 ) << it->mMaxError <<
+			setw( 12 ) << it->mMismatches << setw( 10 ) << it->mFailures << endl;
+	}
+	out.unsetf( ios_base::floatfield );
+}
+
+vector< CalibrationBenchmark::TriangleResult > CalibrationBenchmark::runTriangles( size_t queries )
+{
+	Rand rnd( 2 );
+
+	// random triangles of both windings, every fourth one a sliver,
+	// with points around them
+	vector< Trianglef > triangles;
+	vector< Vec2f > points;
+	triangles.reserve( queries );
+	points.reserve( queries );
+	for ( size_t i = 0; i < queries; i++ )
+	{
+		Vec2f a( rnd.nextFloat(), rnd.nextFloat() );
+		Vec2f b( rnd.nextFloat(), rnd.nextFloat() );
+		Vec2f c( rnd.nextFloat(), rnd.nextFloat() );
+		if ( ( i % 4 ) == 3 )
+			c = a + ( b - a ) * rnd.nextFloat() + rnd.nextVec2f() * .001f;
+		triangles.push_back( Trianglef( a, b, c ) );
+		points.push_back( Vec2f( rnd.nextFloat( -.5f, 1.5f ), rnd.nextFloat( -.5f, 1.5f ) ) );
+	}
+
+	vector< double > reference( queries );
+	vector< float > distances( queries );
+	vector< Vec2f > closest( queries );
+	vector< TriangleResult > results;
+	Timer timer;
+
+	TriangleResult r;
+	r.mQueries = queries;
+	r.mMaxError = 0.;
+	r.mFailures = 0;
+
+	timer.start();
+	for ( size_t i = 0; i < queries; i++ )
+	{
+		const Trianglef &t = triangles[ i ];
+		reference[ i ] = referenceDistanceSquared( Triangled( Vec2d( t.a() ), Vec2d( t.b() ), Vec2d( t.c() ) ),
+				Vec2d( points[ i ] ) );
+	}
+	timer.stop();
+	r.mMethod = "reference";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < queries; i++ )
+		distances[ i ] = triangles[ i ].distanceSquared( points[ i ] );
+	timer.stop();
+	r.mMethod = "distanceSquared";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	for ( size_t i = 0; i < queries; i++ )
+	{
+		double error = math< double >::abs( math< double >::sqrt( distances[ i ] ) -
+				math< double >::sqrt( reference[ i ] ) );
+		r.mMaxError = math< double >::max( r.mMaxError, error );
+		if ( error > TRIANGLE_TOLERANCE )
+			r.mFailures++;
+	}
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < queries; i++ )
+		closest[ i ] = triangles[ i ].closestPoint( points[ i ] );
+	timer.stop();
+	r.mMethod = "closestPoint";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	r.mMaxError = 0.;
+	r.mFailures = 0;
+	for ( size_t i = 0; i < queries; i++ )
+	{
+		// the closest point is on the triangle, at the reference distance
+		const Trianglef &t = triangles[ i ];
+		double onTriangle = math< double >::sqrt( referenceDistanceSquared(
+					Triangled( Vec2d( t.a() ), Vec2d( t.b() ), Vec2d( t.c() ) ), Vec2d( closest[ i ] ) ) );
+		double error = math< double >::abs( Vec2d( points[ i ] ).distance( Vec2d( closest[ i ] ) ) -
+				math< double >::sqrt( reference[ i ] ) );
+		error = math< double >::max( error, onTriangle );
+		r.mMaxError = math< double >::max( r.mMaxError, error );
+		if ( error > TRIANGLE_TOLERANCE )
+			r.mFailures++;
+	}
+	results.push_back( r );
+
+	// barycentric coordinates with and without the cached inverse basis
+	vector< BarycentricTrianglef > cached( triangles.begin(), triangles.end() );
+	vector< Vec3f > bary( queries );
+
+	timer.start();
+	for ( size_t i = 0; i < queries; i++ )
+		bary[ i ] = triangles[ i ].toBarycentric( points[ i ] );
+	timer.stop();
+	r.mMethod = "toBarycentric";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	compareBarycentric( triangles, points, bary, &r );
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < queries; i++ )
+		bary[ i ] = cached[ i ].toBarycentric( points[ i ] );
+	timer.stop();
+	r.mMethod = "cached bary";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	compareBarycentric( triangles, points, bary, &r );
+	for ( size_t i = 0; i < queries; i++ )
+	{
+		// containment may only differ on the edges
+		if ( ( cached[ i ].contains( points[ i ] ) != triangles[ i ].contains( points[ i ] ) ) &&
+			 ( math< float >::abs( triangles[ i ].calcArea() ) >= MIN_CONDITIONED_AREA ) )
+		{
+			const Vec3f &b = bary[ i ];
+			float edge = math< float >::min( math< float >::min( math< float >::abs( b.x ),
+						math< float >::abs( b.y ) ), math< float >::abs( b.z ) );
+			if ( edge > BARYCENTRIC_TOLERANCE )
+				r.mFailures++;
+		}
+	}
+	results.push_back( r );
+
+	return results;
+}
+
+vector< CalibrationBenchmark::TriangleResult > CalibrationBenchmark::runTriangleBatch( size_t triangleCount,
+		size_t pointCount )
+{
+	Rand rnd( 3 );
+
+	vector< Trianglef > triangles;
+	TriangleBatchf batch;
+	batch.reserve( triangleCount );
+	for ( size_t i = 0; i < triangleCount; i++ )
+	{
+		Vec2f a( rnd.nextFloat(), rnd.nextFloat() );
+		Trianglef t( a, a + rnd.nextVec2f() * .2f, a + rnd.nextVec2f() * .2f );
+		triangles.push_back( t );
+		batch.push_back( t );
+	}
+
+	vector< Vec2f > points;
+	for ( size_t i = 0; i < pointCount; i++ )
+		points.push_back( Vec2f( rnd.nextFloat( -.2f, 1.2f ), rnd.nextFloat( -.2f, 1.2f ) ) );
+
+	size_t queries = triangleCount * pointCount;
+	vector< uint8_t > loopContains( queries );
+	vector< uint8_t > batchContains( queries );
+	vector< float > loopDistances( queries );
+	vector< float > batchDistances( queries );
+	vector< double > reference( queries );
+	vector< TriangleResult > results;
+
+	for ( size_t j = 0; j < triangleCount; j++ )
+	{
+		const Trianglef &t = triangles[ j ];
+		Triangled td( Vec2d( t.a() ), Vec2d( t.b() ), Vec2d( t.c() ) );
+		for ( size_t i = 0; i < pointCount; i++ )
+			reference[ i * triangleCount + j ] = referenceDistanceSquared( td, Vec2d( points[ i ] ) );
+	}
+
+	Timer timer;
+
+	TriangleResult r;
+	r.mQueries = queries;
+	r.mMaxError = 0.;
+	r.mFailures = 0;
+
+	timer.start();
+	for ( size_t i = 0; i < pointCount; i++ )
+	{
+		uint8_t *result = &loopContains[ i * triangleCount ];
+		for ( size_t j = 0; j < triangleCount; j++ )
+			result[ j ] = triangles[ j ].contains( points[ i ] );
+	}
+	timer.stop();
+	r.mMethod = "loop contains";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < pointCount; i++ )
+		batch.contains( points[ i ], &batchContains[ i * triangleCount ] );
+	timer.stop();
+	r.mMethod = "batch contains";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	vector< Vec3f > bary( triangleCount );
+	for ( size_t i = 0; i < pointCount; i++ )
+	{
+		batch.toBarycentric( points[ i ], &bary[ 0 ] );
+		for ( size_t j = 0; j < triangleCount; j++ )
+		{
+			// containment may only differ on the edges
+			size_t k = i * triangleCount + j;
+			if ( ( loopContains[ k ] != batchContains[ k ] ) &&
+				 ( math< float >::abs( triangles[ j ].calcArea() ) >= MIN_CONDITIONED_AREA ) )
+			{
+				const Vec3f &b = bary[ j ];
+				float edge = math< float >::min( math< float >::min( math< float >::abs( b.x ),
+							math< float >::abs( b.y ) ), math< float >::abs( b.z ) );
+				if ( edge > BARYCENTRIC_TOLERANCE )
+					r.mFailures++;
+			}
+		}
+	}
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < pointCount; i++ )
+	{
+		float *result = &loopDistances[ i * triangleCount ];
+		for ( size_t j = 0; j < triangleCount; j++ )
+			result[ j ] = triangles[ j ].distanceSquared( points[ i ] );
+	}
+	timer.stop();
+	r.mMethod = "loop distance";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	compareDistances( loopDistances, reference, &r );
+	results.push_back( r );
+
+	timer.start();
+	for ( size_t i = 0; i < pointCount; i++ )
+		batch.distanceSquared( points[ i ], &batchDistances[ i * triangleCount ] );
+	timer.stop();
+	r.mMethod = "batch distance";
+	r.mNsPerQuery = timer.getSeconds() * 1e9 / queries;
+	compareDistances( batchDistances, reference, &r );
+	results.push_back( r );
+
+	return results;
+}
+
+void CalibrationBenchmark::print( const vector< TriangleResult > &results, ostream &out )
+{
+	out << setw( 16 ) << left << "query" << right <<
+		setw( 10 ) << "queries" << setw( 10 ) << "ns/query" <<
+		setw( 12 ) << "max error" << setw( 10 ) << "failures" << endl;
+
+	for ( vector< TriangleResult >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		out << setw( 16 ) << left << it->mMethod << right <<
+			setw( 10 ) << it->mQueries <<
+			setw( 10 ) << fixed << setprecision( 1 ) << it->mNsPerQuery <<
+			setw( 12 ) << scientific << setprecision( 2 ) << it->mMaxError <<
+			setw( 10 ) << it->mFailures << endl;
+	}
+	out.unsetf( ios_base::floatfield );
+}
+
+void CalibrationBenchmark::compareBarycentric( const vector< Trianglef > &triangles,
+		const vector< Vec2f > &points, const vector< Vec3f > &bary, TriangleResult *result )
+{
+	result->mMaxError = 0.;
+	result->mFailures = 0;
+	for ( size_t i = 0; i < triangles.size(); i++ )
+	{
+		// slivers are ill-conditioned, their coordinates are not compared
+		const Trianglef &t = triangles[ i ];
+		if ( math< float >::abs( t.calcArea() ) < MIN_CONDITIONED_AREA )
+			continue;
+
+		// the error is relative to the size of the coordinates
+		Vec3d b = Triangled( Vec2d( t.a() ), Vec2d( t.b() ), Vec2d( t.c() ) ).toBarycentric( Vec2d( points[ i ] ) );
+		double scale = math< double >::max( 1., math< double >::max( math< double >::abs( b.x ),
+					math< double >::abs( b.y ) ) );
+		double error = math< double >::max( math< double >::abs( bary[ i ].x - b.x ),
+				math< double >::abs( bary[ i ].y - b.y ) ) / scale;
+		result->mMaxError = math< double >::max( result->mMaxError, error );
+		if ( error > BARYCENTRIC_TOLERANCE )
+			result->mFailures++;
+	}
+}
+
+void CalibrationBenchmark::compareDistances( const vector< float > &distances, const vector< double > &reference,
+		TriangleResult *result )
+{
+	result->mMaxError = 0.;
+	result->mFailures = 0;
+	for ( size_t i = 0; i < distances.size(); i++ )
+	{
+		double error = math< double >::abs( math< double >::sqrt( distances[ i ] ) -
+				math< double >::sqrt( reference[ i ] ) );
+		result->mMaxError = math< double >::max( result->mMaxError, error );
+		if ( error > TRIANGLE_TOLERANCE )
+			result->mFailures++;
+	}
+}
+
+double CalibrationBenchmark::referenceDistanceSquared( const Triangled &triangle, const Vec2d &p )
+{
+	if ( triangle.contains( p ) )
+		return 0.;
+
+	const Vec2d *v[ 3 ] = { &triangle.a(), &triangle.b(), &triangle.c() };
+	double closest = DBL_MAX;
+	for ( int i = 0; i < 3; i++ )
+	{
+		const Vec2d &a = *v[ i ];
+		const Vec2d &b = *v[ ( i + 1 ) % 3 ];
+		Vec2d ab = b - a;
+		double t = math< double >::clamp( ab.dot( p - a ) / ab.lengthSquared(), 0., 1. );
+		closest = math< double >::min( closest, p.distanceSquared( a + ab * t ) );
+	}
+	return closest;
+}
+
+vector< Vec2f > CalibrationBenchmark::generatePoints( size_t frames, size_t *pointsPerFrame )
+{
+	Rand rnd( 1 );
+
+	// pens wander around the camera image, their centroid and bounding box
+	// corners are mapped each frame
+	*pointsPerFrame = PENS * 3;
+	vector< Vec2f > pens( PENS );
+	vector< Vec2f > velocities( PENS );
+	for ( size_t i = 0; i < PENS; i++ )
+	{
+		pens[ i ] = Vec2f( rnd.nextFloat( .1f, .9f ), rnd.nextFloat( .1f, .9f ) );
+		velocities[ i ] = rnd.nextVec2f() * .005f;
+	}
+
+	vector< Vec2f > points;
+	points.reserve( frames * *pointsPerFrame );
+	for ( size_t f = 0; f < frames; f++ )
+	{
+		for ( size_t i = 0; i < PENS; i++ )
+		{
+			Vec2f &p = pens[ i ];
+			Vec2f &v = velocities[ i ];
+			p += v;
+			if ( ( p.x < 0.f ) || ( p.x > 1.f ) )
+				v.x = -v.x;
+			if ( ( p.y < 0.f ) || ( p.y > 1.f ) )
+				v.y = -v.y;
+
+			points.push_back( p );
+			points.push_back( p - Vec2f( BLOB_SIZE, BLOB_SIZE ) );
+			points.push_back( p + Vec2f( BLOB_SIZE, BLOB_SIZE ) );
+		}
+	}
+	return points;
+}
+
+void CalibrationBenchmark::compare( const vector< Vec2f > &mapped, const vector< Vec2f > &exact,
+		const vector< Vec2f > &reference, const vector< uint8_t > *checked, float tolerance,
+		Result *result )
+{
+	result->mMaxError = 0.f;
+	result->mMismatches = 0;
+	result->mFailures = 0;
+	for ( size_t i = 0; i < mapped.size(); i++ )
+	{
+		float error = mapped[ i ].distance( exact[ i ] );
+		result->mMaxError = math< float >::max( result->mMaxError, error );
+		if ( mapped[ i ] != reference[ i ] )
+			result->mMismatches++;
+		if ( ( checked != NULL ) && ( *checked )[ i ] && ( error > tolerance ) )
+			result->mFailures++;
+	}
+}
+
+} // namespace mndl
@@ -0,0 +1,214 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#if defined( CINDER_MSW )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+
+#include "CalibrationCache.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+static const uint32_t CACHE_MAGIC = 0x49524331; // IRC1
+// increment when the layout or the meaning of the cached data changes
+static const uint32_t CACHE_VERSION = 1;
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+class CalibrationCache::MappedFile
+{
+	public:
+		MappedFile() : mData( NULL ), mSize( 0 ) {}
+		~MappedFile() { close(); }
+
+		bool open( const fs::path &path )
+		{
+			close();
+#if defined( CINDER_MSW )
+			HANDLE file = CreateFileA( path.string().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+					OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+			if ( file == INVALID_HANDLE_VALUE )
+				return false;
+
+			LARGE_INTEGER size;
+			if ( !GetFileSizeEx( file, &size ) || ( size.QuadPart == 0 ) )
+			{
+				CloseHandle( file );
+				return false;
+			}
+
+			HANDLE mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+			CloseHandle( file );
+			if ( mapping == NULL )
+				return false;
+
+			void *addr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+			CloseHandle( mapping );
+			if ( addr == NULL )
+				return false;
+			mSize = (size_t)size.QuadPart;
+#else
+			int fd = ::open( path.string().c_str(), O_RDONLY );
+			if ( fd < 0 )
+				return false;
+
+			struct stat st;
+			if ( ( fstat( fd, &st ) < 0 ) || ( st.st_size == 0 ) )
+			{
+				::close( fd );
+				return false;
+			}
+
+			void *addr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			::close( fd );
+			if ( addr == MAP_FAILED )
+				return false;
+			mSize = st.st_size;
+#endif
+			mData = static_cast< const uint8_t * >( addr );
+			return true;
+		}
+
+		void close()
+		{
+			if ( mData == NULL )
+				return;
+#if defined( CINDER_MSW )
+			UnmapViewOfFile( mData );
+#else
+			munmap( const_cast< uint8_t * >( mData ), mSize );
+#endif
+			mData = NULL;
+			mSize = 0;
+		}
+
+		const uint8_t * getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+
+	private:
+		const uint8_t *mData;
+		size_t mSize;
+};
+
+uint64_t CalibrationCache::hashFile( const fs::path &path )
+{
+	MappedFile file;
+	if ( !file.open( path ) )
+		return 0;
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	const uint8_t *data = file.getData();
+	for ( size_t i = 0; i < file.getSize(); i++ )
+	{
+		hash ^= data[ i ];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+bool CalibrationCache::read( const fs::path &path, uint64_t key, Data *data )
+{
+	MappedFile file;
+	if ( !file.open( path ) || ( file.getSize() < sizeof( Header ) ) )
+		return false;
+
+	Header header;
+	memcpy( &header, file.getData(), sizeof( Header ) );
+	if ( ( header.mMagic != CACHE_MAGIC ) || ( header.mVersion != CACHE_VERSION ) ||
+		 ( header.mHeaderSize != sizeof( Header ) ) || ( header.mKey != key ) )
+		return false;
+
+	// the sizes of the sections follow from the grid and the lookup table size
+	if ( ( header.mGridWidth < 2 ) || ( header.mGridHeight < 2 ) || ( header.mLutResolution < 1 ) )
+		return false;
+	size_t numPoints = header.mGridWidth * header.mGridHeight;
+	size_t numCoefficients = ( header.mGridWidth - 1 ) * ( header.mGridHeight - 1 ) * 2 * 6;
+	size_t numLut = ( header.mLutResolution + 1 ) * ( header.mLutResolution + 1 );
+	if ( ( header.mNumPoints != numPoints ) || ( header.mNumCoefficients != numCoefficients ) ||
+		 ( header.mNumLut != numLut ) ||
+		 ( file.getSize() != sizeof( Header ) + ( numPoints * 2 + numCoefficients + numLut * 2 ) * sizeof( float ) ) )
+		return false;
+
+	data->mGridSize = Vec2i( header.mGridWidth, header.mGridHeight );
+	data->mModel = header.mModel;
+	data->mLutResolution = header.mLutResolution;
+	data->mHomographyThreshold = header.mHomographyThreshold;
+	data->mOutputRect = Rectf( header.mOutputRect[ 0 ], header.mOutputRect[ 1 ],
+							   header.mOutputRect[ 2 ], header.mOutputRect[ 3 ] );
+	data->mLutMaxError = header.mLutMaxError;
+
+	const uint8_t *p = file.getData() + sizeof( Header );
+	data->mCameraGrid.resize( numPoints );
+	memcpy( &data->mCameraGrid[ 0 ], p, numPoints * sizeof( Vec2f ) );
+	p += numPoints * sizeof( Vec2f );
+	data->mTriangleCoefficients.resize( numCoefficients );
+	memcpy( &data->mTriangleCoefficients[ 0 ], p, numCoefficients * sizeof( float ) );
+	p += numCoefficients * sizeof( float );
+	data->mLut.resize( numLut );
+	memcpy( &data->mLut[ 0 ], p, numLut * sizeof( Vec2f ) );
+	return true;
+}
+
+bool CalibrationCache::write( const fs::path &path, uint64_t key, const Data &data )
+{
+	Header header;
+	memset( &header, 0, sizeof( Header ) );
+	header.mMagic = CACHE_MAGIC;
+	header.mVersion = CACHE_VERSION;
+	header.mKey = key;
+	header.mHeaderSize = sizeof( Header );
+	header.mGridWidth = data.mGridSize.x;
+	header.mGridHeight = data.mGridSize.y;
+	header.mModel = data.mModel;
+	header.mLutResolution = data.mLutResolution;
+	header.mHomographyThreshold = data.mHomographyThreshold;
+	header.mOutputRect[ 0 ] = data.mOutputRect.x1;
+	header.mOutputRect[ 1 ] = data.mOutputRect.y1;
+	header.mOutputRect[ 2 ] = data.mOutputRect.x2;
+	header.mOutputRect[ 3 ] = data.mOutputRect.y2;
+	header.mLutMaxError = data.mLutMaxError;
+	header.mNumPoints = data.mCameraGrid.size();
+	header.mNumCoefficients = data.mTriangleCoefficients.size();
+	header.mNumLut = data.mLut.size();
+
+	ofstream out( path.string().c_str(), ios::binary | ios::trunc );
+	out.write( reinterpret_cast< const char * >( &header ), sizeof( Header ) );
+	if ( !data.mCameraGrid.empty() )
+		out.write( reinterpret_cast< const char * >( &data.mCameraGrid[ 0 ] ),
+				data.mCameraGrid.size() * sizeof( Vec2f ) );
+	if ( !data.mTriangleCoefficients.empty() )
+		out.write( reinterpret_cast< const char * >( &data.mTriangleCoefficients[ 0 ] ),
+				data.mTriangleCoefficients.size() * sizeof( float ) );
+	if ( !data.mLut.empty() )
+		out.write( reinterpret_cast< const char * >( &data.mLut[ 0 ] ), data.mLut.size() * sizeof( Vec2f ) );
+	return out.good();
+}
+
+} // namespace mndl
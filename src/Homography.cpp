@@ -0,0 +1,122 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cinder/CinderMath.h"
+
+#include "Homography.h"
+#include "LinearSystem.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+//! Similarity transform moving the centroid of \a points to the origin at an average distance of sqrt( 2 )
+static void normalization( const vector< Vec2f > &points, double *t )
+{
+	Vec2d centroid( 0., 0. );
+	for ( size_t i = 0; i < points.size(); i++ )
+		centroid += Vec2d( points[ i ] );
+	centroid /= (double)points.size();
+
+	double dist = 0.;
+	for ( size_t i = 0; i < points.size(); i++ )
+		dist += Vec2d( points[ i ] ).distance( centroid );
+	dist /= points.size();
+
+	double s = ( dist > 0. ) ? math< double >::sqrt( 2. ) / dist : 1.;
+	t[ 0 ] = s; t[ 1 ] = 0.; t[ 2 ] = -s * centroid.x;
+	t[ 3 ] = 0.; t[ 4 ] = s; t[ 5 ] = -s * centroid.y;
+	t[ 6 ] = 0.; t[ 7 ] = 0.; t[ 8 ] = 1.;
+}
+
+static void multiply( const double *a, const double *b, double *r )
+{
+	for ( int i = 0; i < 3; i++ )
+	{
+		for ( int j = 0; j < 3; j++ )
+			r[ i * 3 + j ] = a[ i * 3 ] * b[ j ] + a[ i * 3 + 1 ] * b[ 3 + j ] + a[ i * 3 + 2 ] * b[ 6 + j ];
+	}
+}
+
+void Homography::setIdentity()
+{
+	for ( int i = 0; i < 9; i++ )
+		mH[ i ] = ( i % 4 == 0 ) ? 1. : 0.;
+}
+
+bool Homography::fit( const vector< Vec2f > &src, const vector< Vec2f > &dst )
+{
+	setIdentity();
+
+	size_t n = src.size();
+	if ( ( n < 4 ) || ( dst.size() != n ) )
+		return false;
+
+	// the points are normalized for the conditioning of the system
+	double ts[ 9 ], td[ 9 ];
+	normalization( src, ts );
+	normalization( dst, td );
+
+	// with h8 = 1 each point gives two equations linear in h0 .. h7
+	// u = ( h0 x + h1 y + h2 ) / ( h6 x + h7 y + 1 )
+	// v = ( h3 x + h4 y + h5 ) / ( h6 x + h7 y + 1 ),
+	// solved in the least squares sense by the normal equations
+	vector< double > a( 8 * 9, 0. );
+	for ( size_t i = 0; i < n; i++ )
+	{
+		double x = ts[ 0 ] * src[ i ].x + ts[ 2 ];
+		double y = ts[ 4 ] * src[ i ].y + ts[ 5 ];
+		double u = td[ 0 ] * dst[ i ].x + td[ 2 ];
+		double v = td[ 4 ] * dst[ i ].y + td[ 5 ];
+
+		double rows[ 2 ][ 9 ] = {
+			{ x, y, 1., 0., 0., 0., -u * x, -u * y, u },
+			{ 0., 0., 0., x, y, 1., -v * x, -v * y, v } };
+		for ( int r = 0; r < 2; r++ )
+		{
+			for ( int j = 0; j < 8; j++ )
+			{
+				for ( int k = 0; k < 9; k++ )
+					a[ j * 9 + k ] += rows[ r ][ j ] * rows[ r ][ k ];
+			}
+		}
+	}
+
+	vector< double > h;
+	if ( !solveLinearSystem( a, 8, 1, &h ) )
+		return false;
+
+	// denormalize, H = td^-1 * Hn * ts
+	double hn[ 9 ] = { h[ 0 ], h[ 1 ], h[ 2 ], h[ 3 ], h[ 4 ], h[ 5 ], h[ 6 ], h[ 7 ], 1. };
+	double tdInv[ 9 ] = { 1. / td[ 0 ], 0., -td[ 2 ] / td[ 0 ],
+						  0., 1. / td[ 4 ], -td[ 5 ] / td[ 4 ],
+						  0., 0., 1. };
+	double tmp[ 9 ];
+	multiply( hn, ts, tmp );
+	multiply( tdInv, tmp, mH );
+	return true;
+}
+
+Vec2f Homography::map( const Vec2f &p ) const
+{
+	double w = mH[ 6 ] * p.x + mH[ 7 ] * p.y + mH[ 8 ];
+	return Vec2f( (float)( ( mH[ 0 ] * p.x + mH[ 1 ] * p.y + mH[ 2 ] ) / w ),
+				  (float)( ( mH[ 3 ] * p.x + mH[ 4 ] * p.y + mH[ 5 ] ) / w ) );
+}
+
+} // namespace mndl
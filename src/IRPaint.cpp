@@ -16,8 +16,11 @@
 */
 
 #include <map>
+#include <string>
 #include <vector>
 
+#include <boost/assign.hpp>
+
 #include "cinder/app/AppBasic.h"
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Fbo.h"
@@ -35,6 +38,8 @@
 #include "BlobTracker.h"
 #include "PParams.h"
 #include "Stroke.h"
+#include "StrokeBatch.h"
+#include "StrokeBenchmark.h"
 #include "Utils.h"
 #include "TextureMenu.h"
 #include "License.h"
@@ -78,19 +83,27 @@ class IRPaint : public AppBasic
 		shared_ptr< mndl::ManualCalibration > mCalibratorRef;
 
 		map< int32_t, Stroke > mStrokes;
+		StrokeBatch mStrokeBatch;
+		int mStrokeRenderer; //< StrokeBatch::Renderer
+		void strokeBenchmarkCB();
 
 		void beginStroke( int32_t id, const Vec2f &pos );
 		void updateStroke( int32_t id, const Vec2f &pos );
 		void endStroke( int32_t id );
 
-		//! Mapping from normalized coordinates to window size
-		RectMapping mCoordMapping;
 		//! Mapping from window coordinates to brush and color map size (1024x768)
 		RectMapping mMapMapping;
+		//! Mapping from brush and color map coordinates to window coordinates
+		RectMapping mWindowMapping;
+
+		vector< Vec2f > mBlobPoints; //< blob positions of a frame to be calibrated
+		vector< Vec2f > mMappedBlobPoints; //< calibrated \a mBlobPoints
 
-		void blobsBegan( mndl::BlobEvent event );
-		void blobsMoved( mndl::BlobEvent event );
-		void blobsEnded( mndl::BlobEvent event );
+		void blobsFrame( const mndl::BlobFrameEvent &event );
+		//! Handles a began event, \a mapped points to its mapped position and bounding box corners
+		void blobsBegan( const mndl::BlobEvent &event, const Vec2f *mapped );
+		void blobsMoved( const mndl::BlobEvent &event, const Vec2f &mapped );
+		void blobsEnded( const mndl::BlobEvent &event );
 
 		void selectTools( const Vec2f &pos, const Area &area );
 		gl::GlslProg mMixerShader;
@@ -149,20 +162,20 @@ void IRPaint::prepareSettings( Settings *settings )
 
 void IRPaint::resize( ResizeEvent event )
 {
-	mCoordMapping = RectMapping( Rectf( 0, 0, 1, 1 ),
-			Rectf( Vec2f( 0, 0 ), event.getSize() ) );
 	mMapMapping = RectMapping( Rectf( Vec2f::zero(), event.getSize() ),
 							   mBrushesMap.getBounds() );
+	mWindowMapping = RectMapping( mBrushesMap.getBounds(),
+								  Rectf( Vec2f::zero(), event.getSize() ) );
 	mMenu.setPosition( ( event.getSize() - mMenu.getSize() ) / 2 );
 }
 
 /** Selects color and brush size from the toolbar from the location of \a pos.
  *  Called on blob enter or mouse down.
- *  \param pos position in window coordinates **/
+ *  \param pos position in brush and color map coordinates
+ *  \param area blob area in brush and color map coordinates **/
 void IRPaint::selectTools( const Vec2f &pos, const Area &area )
 {
-	Vec2f mapPos = mMapMapping.map( pos );
-	Vec2i mapPosi( (int)mapPos.x, (int)mapPos.y );
+	Vec2i mapPosi( (int)pos.x, (int)pos.y );
 
 	ColorA8u colorSelect = mColorsMap.getPixel( mapPosi );
 	if ( colorSelect.a )
@@ -193,17 +206,9 @@ void IRPaint::selectTools( const Vec2f &pos, const Area &area )
 	else
 	if ( mBrushesStencil.getPixel( mapPosi ).a ) // more accurate brush selection
 	{
-		// map area
-		Vec2i ul = area.getUL();
-		Vec2i lr = area.getLR();
-		Vec2f ulM = mMapMapping.map( ul );
-		Vec2f lrM = mMapMapping.map( lr );
-		Area areaMap( (int32_t)ulM.x, (int32_t)ulM.y,
-					  (int32_t)lrM.x, (int32_t)lrM.y );
-
 		// calculate histogram of brush indices
 		map< int32_t, int > hist;
-		Surface::Iter iter = mBrushesMap.getIter( areaMap );
+		Surface::Iter iter = mBrushesMap.getIter( area );
 		while ( iter.line() )
 		{
 			while ( iter.pixel() )
@@ -240,8 +245,6 @@ void IRPaint::selectTools( const Vec2f &pos, const Area &area )
 void IRPaint::beginStroke( int32_t id, const Vec2f &pos )
 {
 	mStrokes[ id ] = Stroke();
-	Vec2f drawingPos = mMapMapping.map( pos );
-	mStrokes[ id ].resize( ResizeEvent( mDrawing.getSize() ) );
 	if ( mBrushIndex == BRUSH_ERASER )
 		mStrokes[ id ].setColor( ColorA( 0, 0, 0, 0 ) );
 		//mStrokes[ id ].setColor( Color::white() );
@@ -249,65 +252,86 @@ void IRPaint::beginStroke( int32_t id, const Vec2f &pos )
 		mStrokes[ id ].setColor( mBrushColor );
 	mStrokes[ id ].setThickness( mBrushThickness[ mBrushIndex ] );
 
-	mStrokes[ id ].update( drawingPos );
+	mStrokes[ id ].update( pos );
 }
 
 void IRPaint::updateStroke( int32_t id, const Vec2f &pos )
 {
-	Vec2f drawingPos = mMapMapping.map( pos );
-	mStrokes[ id ].update( drawingPos );
+	mStrokes[ id ].update( pos );
 }
 
 void IRPaint::endStroke( int32_t id )
 {
 	map< int32_t, Stroke >::iterator it;
 	it = mStrokes.find( id );
-	mStrokes.erase( id );
+	if ( it == mStrokes.end() )
+		return;
+
+	// the segments added since the last frame are still drawn
+	mStrokeBatch.add( it->second );
+	mStrokes.erase( it );
 }
 
 
-void IRPaint::blobsBegan( mndl::BlobEvent event )
+void IRPaint::blobsFrame( const mndl::BlobFrameEvent &event )
 {
-	if ( mCalibratorRef->isCalibrating() )
+	if ( mCalibratorRef->isCalibrating() || mCalibratorRef->isVerifying() )
 		return;
 
-	Vec2f pos = mCalibratorRef->map( event.getPos() );
-	pos = mCoordMapping.map( pos );
+	mndl::BlobEventRange began = event.getBegan();
+	mndl::BlobEventRange moved = event.getMoved();
+
+	// calibrate all positions of the frame at once, the centroid and the
+	// bounding box corners of began blobs, the centroid of moved ones
+	mBlobPoints.clear();
+	for ( mndl::BlobEventRange::const_iterator it = began.begin(); it != began.end(); ++it )
+	{
+		const Rectf &bbox = it->getBoundingBox();
+		mBlobPoints.push_back( it->getPos() );
+		mBlobPoints.push_back( bbox.getUpperLeft() );
+		mBlobPoints.push_back( bbox.getLowerRight() );
+	}
+	for ( mndl::BlobEventRange::const_iterator it = moved.begin(); it != moved.end(); ++it )
+		mBlobPoints.push_back( it->getPos() );
+
+	mMappedBlobPoints.resize( mBlobPoints.size() );
+	if ( !mBlobPoints.empty() )
+		mCalibratorRef->map( &mBlobPoints[ 0 ], &mMappedBlobPoints[ 0 ], mBlobPoints.size() );
+
+	size_t i = 0;
+	for ( mndl::BlobEventRange::const_iterator it = began.begin(); it != began.end(); ++it, i += 3 )
+		blobsBegan( *it, &mMappedBlobPoints[ i ] );
+
+	for ( mndl::BlobEventRange::const_iterator it = moved.begin(); it != moved.end(); ++it, i++ )
+		blobsMoved( *it, mMappedBlobPoints[ i ] );
+
+	mndl::BlobEventRange ended = event.getEnded();
+	for ( mndl::BlobEventRange::const_iterator it = ended.begin(); it != ended.end(); ++it )
+		blobsEnded( *it );
+}
 
-	// map bounding box
-	Rectf bbox = event.getBoundingBox();
-	Vec2f ul = mCalibratorRef->map( bbox.getUpperLeft() );
-	Vec2f lr = mCalibratorRef->map( bbox.getLowerRight() );
-	ul = mCoordMapping.map( ul );
-	lr = mCoordMapping.map( lr );
-	Area area = Area( int32_t( ul.x ), int32_t( ul.y ),
-					  int32_t( lr.x ), int32_t( lr.y ) );
+void IRPaint::blobsBegan( const mndl::BlobEvent &event, const Vec2f *mapped )
+{
+	const Vec2f &pos = mapped[ 0 ];
+	Area area = Area( int32_t( mapped[ 1 ].x ), int32_t( mapped[ 1 ].y ),
+					  int32_t( mapped[ 2 ].x ), int32_t( mapped[ 2 ].y ) );
 
 	selectTools( pos, area );
 
 	if ( mMenu.isVisible() )
-		mMenu.processClick( pos );
+		mMenu.processClick( mWindowMapping.map( pos ) );
 	else
 		beginStroke( event.getId(), pos );
 }
 
-void IRPaint::blobsMoved( mndl::BlobEvent event )
+void IRPaint::blobsMoved( const mndl::BlobEvent &event, const Vec2f &mapped )
 {
-	if ( mCalibratorRef->isCalibrating() )
-		return;
-
-	Vec2f pos = mCalibratorRef->map( event.getPos() );
-	pos = mCoordMapping.map( pos );
-
 	if ( !mMenu.isVisible() )
-		updateStroke( event.getId(), pos );
+		updateStroke( event.getId(), mapped );
 }
 
-void IRPaint::blobsEnded( mndl::BlobEvent event )
+void IRPaint::blobsEnded( const mndl::BlobEvent &event )
 {
-	if ( mCalibratorRef->isCalibrating() )
-		return;
-
 	if ( !mMenu.isVisible() )
 		endStroke( event.getId() );
 }
@@ -360,6 +384,11 @@ void IRPaint::setup()
 	mParams.addText( "Debug" );
 	mParams.addParam( "Brush index", &mBrushIndex, "", true );
 	mParams.addParam( "Brush color", &mBrushColor, "", true );
+	vector< string > rendererNames = boost::assign::list_of( "Geometry shader" )( "CPU tessellator" )
+		( "Instanced capsules" );
+	mParams.addPersistentParam( "Stroke renderer", rendererNames, &mStrokeRenderer,
+			StrokeBatch::RENDERER_GEOMETRY_SHADER );
+	mParams.addButton( "Stroke benchmark", std::bind( &IRPaint::strokeBenchmarkCB, this ) );
 
 	try
 	{
@@ -395,12 +424,15 @@ void IRPaint::setup()
 	mDrawing = gl::Fbo( mBackground.getWidth(), mBackground.getHeight(), format );
 	clearDrawing();
 
-	mTracker.setup();
+	mStrokeBatch.setup();
+	mStrokeBatch.resize( mDrawing.getSize() );
+
+	// blob positions are calibrated directly to brush and color map coordinates,
+	// the rectangle is passed at setup not to bake the lookup table twice
+	mTracker.setup( mBrushesMap.getBounds() );
 	mCalibratorRef = mTracker.getCalibrator();
 
-	mTracker.registerBlobsCallbacks< IRPaint >( &IRPaint::blobsBegan,
-												&IRPaint::blobsMoved,
-												&IRPaint::blobsEnded, this );
+	mTracker.registerBlobsFrame< IRPaint >( &IRPaint::blobsFrame, this );
 
 	// screenshots
 	mScreenshotFolder = getAppPath();
@@ -438,6 +470,7 @@ void IRPaint::clearDrawing()
 	mDrawing.unbindFramebuffer();
 
 	mStrokes.clear();
+	mStrokeBatch.clear();
 
 	// hide the menu
 	std::function< void() > fn = std::bind( &mndl::gl::TextureMenu::hide, &mMenu );
@@ -474,6 +507,7 @@ void IRPaint::loadImages()
 	mColorsGlow.push_back( loadImage( loadResource( RES_GLOW_COLOR_7 ) ) );
 
 	mMapMapping = RectMapping( getWindowBounds(), mBrushesMap.getBounds() );
+	mWindowMapping = RectMapping( mBrushesMap.getBounds(), getWindowBounds() );
 
 	// calculate area bounding box for saving drawing
 	Surface::ConstIter it = areaStencilSurf.getIter();
@@ -548,7 +582,7 @@ void IRPaint::draw()
 		return;
 	}
 
-	// draw strokes
+	// draw the new segments of the strokes, the drawing keeps the earlier ones
 	mDrawing.bindFramebuffer();
 	gl::setMatricesWindow( mDrawing.getSize(), false );
 	gl::setViewport( mDrawing.getBounds() );
@@ -560,8 +594,10 @@ void IRPaint::draw()
 	for ( map< int32_t, Stroke >::iterator it = mStrokes.begin();
 			it != mStrokes.end(); ++it )
 	{
-		it->second.draw();
+		mStrokeBatch.add( it->second );
 	}
+	mStrokeBatch.setRenderer( static_cast< StrokeBatch::Renderer >( mStrokeRenderer ) );
+	mStrokeBatch.draw();
 
 	gl::disableAlphaBlending();
 	mDrawing.unbindFramebuffer();
@@ -607,6 +643,15 @@ void IRPaint::draw()
 	params::PInterfaceGl::draw();
 }
 
+void IRPaint::strokeBenchmarkCB()
+{
+	vector< StrokeBenchmark::Result > results = StrokeBenchmark::runTessellator();
+	StrokeBenchmark::print( results, console() );
+	vector< StrokeBenchmark::RendererResult > rendererResults =
+		StrokeBenchmark::runRenderers( mDrawing.getSize() );
+	StrokeBenchmark::print( rendererResults, console() );
+}
+
 void IRPaint::saveScreenshot()
 {
 	// NOTE: slow because GPU->CPU copy
@@ -690,18 +735,21 @@ void IRPaint::showAllParams( bool visible )
 void IRPaint::mouseDown( MouseEvent event )
 {
 	Vec2i pos = event.getPos();
+	Vec2f mapPos = mMapMapping.map( pos );
 	if ( mMenu.isVisible() )
 		mMenu.processClick( pos );
 	else
-		beginStroke( 1, pos );
+		beginStroke( 1, mapPos );
 
-	selectTools( pos, Area( pos - Vec2i( 1, 1 ), pos + Vec2i( 1, 1 ) ) );
+	Vec2f ul = mMapMapping.map( Vec2f( pos - Vec2i( 1, 1 ) ) );
+	Vec2f lr = mMapMapping.map( Vec2f( pos + Vec2i( 1, 1 ) ) );
+	selectTools( mapPos, Area( (int32_t)ul.x, (int32_t)ul.y, (int32_t)lr.x, (int32_t)lr.y ) );
 }
 
 void IRPaint::mouseDrag( MouseEvent event )
 {
 	if ( !mMenu.isVisible() )
-		updateStroke( 1, event.getPos() );
+		updateStroke( 1, mMapMapping.map( event.getPos() ) );
 }
 
 void IRPaint::mouseUp( MouseEvent event )
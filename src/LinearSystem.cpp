@@ -0,0 +1,78 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <float.h>
+
+#include <algorithm>
+
+#include "cinder/Cinder.h"
+#include "cinder/CinderMath.h"
+
+#include "LinearSystem.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+bool solveLinearSystem( vector< double > &a, size_t n, size_t rhs, vector< double > *x )
+{
+	size_t stride = n + rhs;
+
+	// gaussian elimination with partial pivoting
+	for ( size_t k = 0; k < n; k++ )
+	{
+		size_t pivot = k;
+		for ( size_t i = k + 1; i < n; i++ )
+		{
+			if ( math< double >::abs( a[ i * stride + k ] ) > math< double >::abs( a[ pivot * stride + k ] ) )
+				pivot = i;
+		}
+		if ( math< double >::abs( a[ pivot * stride + k ] ) < DBL_EPSILON )
+			return false;
+		if ( pivot != k )
+			swap_ranges( a.begin() + k * stride, a.begin() + ( k + 1 ) * stride, a.begin() + pivot * stride );
+
+		const double *rowK = &a[ k * stride ];
+		for ( size_t i = k + 1; i < n; i++ )
+		{
+			double *row = &a[ i * stride ];
+			double f = row[ k ] / rowK[ k ];
+			if ( f == 0. )
+				continue;
+			for ( size_t j = k; j < stride; j++ )
+				row[ j ] -= f * rowK[ j ];
+		}
+	}
+
+	// back substitution
+	x->resize( n * rhs );
+	for ( size_t k = n; k-- > 0; )
+	{
+		const double *row = &a[ k * stride ];
+		for ( size_t c = 0; c < rhs; c++ )
+		{
+			double sum = row[ n + c ];
+			for ( size_t j = k + 1; j < n; j++ )
+				sum -= row[ j ] * ( *x )[ j * rhs + c ];
+			( *x )[ k * rhs + c ] = sum / row[ k ];
+		}
+	}
+	return true;
+}
+
+} // namespace mndl
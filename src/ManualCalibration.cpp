@@ -15,25 +15,45 @@
  along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <float.h>
+#include <iomanip>
+
+#include <boost/assign.hpp>
 
 #include "cinder/app/App.h"
 #include "cinder/gl/gl.h"
 #include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+#include "cinder/Timer.h"
 #include "cinder/Utilities.h"
 #include "cinder/Xml.h"
 
 #include "BlobTracker.h"
+#include "CalibrationBenchmark.h"
+#include "CalibrationCache.h"
 #include "ManualCalibration.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define MNDL_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace ci;
 using namespace std;
 
 namespace mndl {
 
-ManualCalibration::ManualCalibration( BlobTracker *bt ) :
+// number of map() calls timed together for the verification latency,
+// a single call is well below the resolution of the timer
+static const int LATENCY_REPEATS = 1000;
+
+ManualCalibration::ManualCalibration( BlobTracker *bt, const Rectf &outputRect ) :
 	mBlobTrackerRef( bt ), mIsCalibrating( false ),
-	mIsDebugging( false ), mRejectBlobs( false )
+	mIsDebugging( false ), mIsVerifying( false ), mVerificationIndex( 0 ),
+	mVerificationMeanError( 0.f ), mVerificationMaxError( 0.f ), mVerificationLatency( 0.f ),
+	mShowVerification( false ), mRejectBlobs( false ),
+	mOutputRect( outputRect ),
+	mModelBuilt( -1 ), mHomographyMaxResidual( 0.f ), mHomographyBuiltThreshold( -1.f ),
+	mUseHomography( false ), mLutBuiltResolution( 0 ), mLutMaxError( 0.f )
 {
 	mParams = params::PInterfaceGl( "Calibration", Vec2i( 350, 550 ) );
 	mParams.addPersistentSizeAndPosition();
@@ -42,12 +62,28 @@ ManualCalibration::ManualCalibration( BlobTracker *bt ) :
 	mParams.addParam( "Debug", &mIsDebugging );
 	mParams.addPersistentParam( "Grid width", &mCalibrationGridSize.x, 4, "min=2 max=16" );
 	mParams.addPersistentParam( "Grid height", &mCalibrationGridSize.y, 3, "min=2 max=16" );
+	mParams.addSeparator();
+	vector< string > enumNames = boost::assign::list_of("Triangles")("Thin-plate spline");
+	mParams.addPersistentParam( "Model", enumNames, &mModel, MODEL_TRIANGLES );
+	mParams.addPersistentParam( "Homography threshold", &mHomographyThreshold, 0.002f, "min=0.0 max=0.05 step=0.0005" );
+	mParams.addParam( "Homography residual", &mHomographyMaxResidual, "", true );
+	mParams.addParam( "Homography used", &mUseHomography, "", true );
+	mParams.addPersistentParam( "Lookup table size", &mLutResolution, 256, "min=16 max=512" );
+	mParams.addParam( "Lookup table error", &mLutMaxError, "", true );
+	mParams.addButton( "Run benchmark", std::bind( &ManualCalibration::benchmarkCB, this ) );
+	mParams.addSeparator();
+	mParams.addButton( "Verify", std::bind( &ManualCalibration::toggleVerificationCB, this ) );
+	mParams.addPersistentParam( "Verification targets", &mVerificationTargetNum, 20, "min=1 max=200" );
+	mParams.addParam( "Show verification", &mShowVerification );
+	mParams.addParam( "Mean error px", &mVerificationMeanError, "", true );
+	mParams.addParam( "Max error px", &mVerificationMaxError, "", true );
+	mParams.addParam( "Mapping latency ns", &mVerificationLatency, "", true );
 
 	mTimelineRef = Timeline::create();
 	app::timeline().add( mTimelineRef );
 
-	resetGrid();
-	load();
+	if ( !load() )
+		resetGrid();
 }
 
 ManualCalibration::~ManualCalibration()
@@ -70,50 +106,176 @@ void ManualCalibration::stopCalibration()
 
 void ManualCalibration::resetGrid()
 {
+	setupCalibrationGrid();
+	mCameraCalibrationGrid = mCalibrationGrid;
+	setupTriangleGrid();
+}
+
+void ManualCalibration::setupCalibrationGrid()
+{
+	// the grid size params apply from here, the triangles and the mappings
+	// are built with the size of the grid
+	mGridSize = mCalibrationGridSize;
 	mCalibrationGrid.clear();
-	float stepX = 1.f / (float)( mCalibrationGridSize.x - 1 );
-	float stepY = 1.f / (float)( mCalibrationGridSize.y - 1 );
-	for ( int y = 0; y < mCalibrationGridSize.y; y++ )
+	float stepX = 1.f / (float)( mGridSize.x - 1 );
+	float stepY = 1.f / (float)( mGridSize.y - 1 );
+	for ( int y = 0; y < mGridSize.y; y++ )
 	{
-		for ( int x = 0; x < mCalibrationGridSize.x; x++ )
+		for ( int x = 0; x < mGridSize.x; x++ )
 		{
 			mCalibrationGrid.push_back( Vec2f( stepX * x, stepY * y ) );
 		}
 	}
-	mCameraCalibrationGrid = mCalibrationGrid;
-	setupTriangleGrid();
 }
 
 void ManualCalibration::setupTriangleGrid()
+{
+	setupTriangles();
+
+	// barycentric coordinates in the camera triangle are linear in the
+	// point coordinates, the mapped point is c + l1 * ( a - c ) + l2 * ( b - c ).
+	// The inverse basis of degenerate triangles is 0, they map everything to c.
+	mTriangleMappings.resize( mCameraTriangleGrid.size() );
+	for ( size_t i = 0; i < mCameraTriangleGrid.size(); i++ )
+	{
+		const BarycentricTrianglef &cam = mCameraTriangleGrid[ i ];
+		const Trianglef &out = mTriangleGrid[ i ];
+		TriangleMapping &m = mTriangleMappings[ i ];
+
+		// l1 = l1x * x + l1y * y + l1z, l2 likewise
+		const float *inv = cam.getInvBasis();
+		float l1x = inv[ 0 ];
+		float l1y = inv[ 1 ];
+		float l1z = -( l1x * cam.c().x + l1y * cam.c().y );
+		float l2x = inv[ 2 ];
+		float l2y = inv[ 3 ];
+		float l2z = -( l2x * cam.c().x + l2y * cam.c().y );
+
+		Vec2f oa = out.a() - out.c();
+		Vec2f ob = out.b() - out.c();
+		m.mX = Vec3f( l1x * oa.x + l2x * ob.x, l1y * oa.x + l2y * ob.x,
+					  out.c().x + l1z * oa.x + l2z * ob.x );
+		m.mY = Vec3f( l1x * oa.y + l2x * ob.y, l1y * oa.y + l2y * ob.y,
+					  out.c().y + l1z * oa.y + l2z * ob.y );
+
+		// compose with the mapping from normalized coordinates to the output
+		m.mX *= mOutputRect.getWidth();
+		m.mX.z += mOutputRect.x1;
+		m.mY *= mOutputRect.getHeight();
+		m.mY.z += mOutputRect.y1;
+	}
+
+	setupHomography();
+	setupSpline();
+	setupLookupTable();
+}
+
+void ManualCalibration::setupSpline()
+{
+	// the smooth model is only evaluated while baking the lookup table
+	mSpline.clear();
+	if ( ( mModel == MODEL_THIN_PLATE_SPLINE ) &&
+		 !mSpline.fit( mCameraCalibrationGrid, mCalibrationGrid ) )
+		app::console() << "thin-plate spline fit failed, using triangles" << endl;
+	mModelBuilt = mModel;
+}
+
+void ManualCalibration::setupTriangles()
 {
 	mTriangleGrid.clear();
 	mCameraTriangleGrid.clear();
 
 	Vec2f p0, p1, p2;
-	for ( size_t y = 0; y < mCalibrationGridSize.y - 1; y++ )
+	for ( size_t y = 0; y < mGridSize.y - 1; y++ )
 	{
-		for ( size_t x = 0; x < mCalibrationGridSize.x - 1; x++ )
+		for ( size_t x = 0; x < mGridSize.x - 1; x++ )
 		{
-			size_t offset = x + y * mCalibrationGridSize.x;
+			size_t offset = x + y * mGridSize.x;
 			p0 = mCalibrationGrid[ offset ];
-			p1 = mCalibrationGrid[ offset + mCalibrationGridSize.x ];
-			p2 = mCalibrationGrid[ offset + mCalibrationGridSize.x  + 1];
+			p1 = mCalibrationGrid[ offset + mGridSize.x ];
+			p2 = mCalibrationGrid[ offset + mGridSize.x  + 1];
 			mTriangleGrid.push_back( Trianglef( p0, p1, p2 ) );
 
 			p0 = mCalibrationGrid[ offset ];
-			p1 = mCalibrationGrid[ offset + mCalibrationGridSize.x  + 1];
+			p1 = mCalibrationGrid[ offset + mGridSize.x  + 1];
 			p2 = mCalibrationGrid[ offset + 1 ];
 			mTriangleGrid.push_back( Trianglef( p0, p1, p2 ) );
 
 			p0 = mCameraCalibrationGrid[ offset ];
-			p1 = mCameraCalibrationGrid[ offset + mCalibrationGridSize.x ];
-			p2 = mCameraCalibrationGrid[ offset + mCalibrationGridSize.x  + 1];
-			mCameraTriangleGrid.push_back( Trianglef( p0, p1, p2 ) );
+			p1 = mCameraCalibrationGrid[ offset + mGridSize.x ];
+			p2 = mCameraCalibrationGrid[ offset + mGridSize.x  + 1];
+			mCameraTriangleGrid.push_back( BarycentricTrianglef( Trianglef( p0, p1, p2 ) ) );
 
 			p0 = mCameraCalibrationGrid[ offset ];
-			p1 = mCameraCalibrationGrid[ offset + mCalibrationGridSize.x  + 1];
+			p1 = mCameraCalibrationGrid[ offset + mGridSize.x  + 1];
 			p2 = mCameraCalibrationGrid[ offset + 1 ];
-			mCameraTriangleGrid.push_back( Trianglef( p0, p1, p2 ) );
+			mCameraTriangleGrid.push_back( BarycentricTrianglef( Trianglef( p0, p1, p2 ) ) );
+		}
+	}
+	mCameraLocator.setup( mCameraTriangleGrid, mGridSize );
+}
+
+void ManualCalibration::setupHomography()
+{
+	bool fitted = mHomography.fit( mCameraCalibrationGrid, mCalibrationGrid );
+
+	size_t n = mCalibrationGrid.size();
+	mHomographyGridSize = mGridSize;
+	mHomographyCorrections.resize( n );
+	mHomographyResiduals.resize( n );
+	mHomographyMaxResidual = 0.f;
+	for ( size_t i = 0; i < n; i++ )
+	{
+		mHomographyCorrections[ i ] = mCalibrationGrid[ i ] - mHomography.map( mCameraCalibrationGrid[ i ] );
+		mHomographyResiduals[ i ] = mHomographyCorrections[ i ].length();
+		mHomographyMaxResidual = math< float >::max( mHomographyMaxResidual, mHomographyResiduals[ i ] );
+	}
+
+	mUseHomography = fitted && ( mHomographyMaxResidual <= mHomographyThreshold );
+	mHomographyBuiltThreshold = mHomographyThreshold;
+}
+
+void ManualCalibration::setOutputRect( const Rectf &rect )
+{
+	if ( ( rect.x1 == mOutputRect.x1 ) && ( rect.y1 == mOutputRect.y1 ) &&
+		 ( rect.x2 == mOutputRect.x2 ) && ( rect.y2 == mOutputRect.y2 ) )
+		return;
+
+	mOutputRect = rect;
+	setupTriangleGrid();
+	// the cache of the previous rectangle would be rebaked on every start
+	if ( fs::exists( mConfigFile ) )
+		saveCache( CalibrationCache::hashFile( mConfigFile ) );
+}
+
+void ManualCalibration::setupLookupTable()
+{
+	int n = mLutResolution + 1;
+	float step = 1.f / mLutResolution;
+
+	mLut.resize( n * n );
+	for ( int y = 0; y < n; y++ )
+	{
+		for ( int x = 0; x < n; x++ )
+		{
+			mLut[ x + y * n ] = mapExact( Vec2f( x * step, y * step ) );
+		}
+	}
+	mLutBuiltResolution = mLutResolution;
+
+	// the triangle mapping is piecewise linear, the interpolation error is
+	// the largest in cells crossed by triangle edges, around the cell centers.
+	// Outside of the grid the closest triangles extrapolate differently,
+	// the mapping is not continuous there, only the grid is measured.
+	mLutMaxError = 0.f;
+	for ( int y = 0; y < mLutResolution; y++ )
+	{
+		for ( int x = 0; x < mLutResolution; x++ )
+		{
+			Vec2f p( ( x + .5f ) * step, ( y + .5f ) * step );
+			if ( mCameraLocator.locate( p ) < 0 )
+				continue;
+			mLutMaxError = math< float >::max( mLutMaxError, map( p ).distance( mapExact( p ) ) );
 		}
 	}
 }
@@ -135,10 +297,12 @@ void ManualCalibration::toggleCalibrationCB()
 	}
 	else
 	{
+		if ( mIsVerifying )
+			toggleVerificationCB();
 		resetGrid();
 
 		mParams.setOptions( "Calibrate", "label=`Stop calibration`" );
-		sBeganCB = mBlobTrackerRef->registerBlobsBegan< ManualCalibration >( &ManualCalibration::blobsBegan, this );
+		sBeganCB = mBlobTrackerRef->registerBlobsFrame< ManualCalibration >( &ManualCalibration::blobsFrame, this );
 		mCalibrationGridIndex = 0;
 		mLastCalibrationIndexReceived = -1;
 		mCalibrationId = 0;
@@ -147,10 +311,129 @@ void ManualCalibration::toggleCalibrationCB()
 	mIsCalibrating = !mIsCalibrating;
 }
 
+void ManualCalibration::toggleVerificationCB()
+{
+	static boost::signals2::connection sBeganCB;
+
+	if ( mIsVerifying )
+	{
+		mParams.setOptions( "Verify", "label=`Verify`" );
+		mBlobTrackerRef->unregisterBlobsCallback( sBeganCB );
+		reportVerification();
+	}
+	else
+	{
+		if ( mIsCalibrating )
+			toggleCalibrationCB();
+
+		mParams.setOptions( "Verify", "label=`Stop verification`" );
+		sBeganCB = mBlobTrackerRef->registerBlobsFrame< ManualCalibration >( &ManualCalibration::blobsFrame, this );
+		mVerificationTargets.clear();
+		for ( int i = 0; i < mVerificationTargetNum; i++ )
+			mVerificationTargets.push_back( Vec2f( Rand::randFloat( .05f, .95f ), Rand::randFloat( .05f, .95f ) ) );
+		mVerificationSamples.clear();
+		mVerificationIndex = 0;
+		mLastCalibrationIndexReceived = -1;
+		mCalibrationId = 0;
+		mShowVerification = false;
+	}
+	mIsVerifying = !mIsVerifying;
+}
+
+void ManualCalibration::reportVerification()
+{
+	if ( mVerificationSamples.empty() )
+		return;
+
+	int cellsX = mGridSize.x - 1;
+	int cellsY = mGridSize.y - 1;
+	vector< int > cellCounts( cellsX * cellsY, 0 );
+	mVerificationCellErrors.assign( cellsX * cellsY, 0.f );
+
+	mVerificationMeanError = 0.f;
+	mVerificationMaxError = 0.f;
+	double latency = 0.;
+	for ( vector< VerificationSample >::const_iterator it = mVerificationSamples.begin();
+			it != mVerificationSamples.end(); ++it )
+	{
+		mVerificationMeanError += it->mError;
+		mVerificationMaxError = math< float >::max( mVerificationMaxError, it->mError );
+		latency += it->mLatency;
+
+		int x = math< int >::min( (int)( it->mTarget.x * cellsX ), cellsX - 1 );
+		int y = math< int >::min( (int)( it->mTarget.y * cellsY ), cellsY - 1 );
+		mVerificationCellErrors[ x + y * cellsX ] += it->mError;
+		cellCounts[ x + y * cellsX ]++;
+	}
+	mVerificationMeanError /= mVerificationSamples.size();
+	mVerificationLatency = (float)( latency / mVerificationSamples.size() * 1e9 );
+
+	app::console() << "verification of " << mVerificationSamples.size() << " targets, mean error " <<
+		mVerificationMeanError << ", max error " << mVerificationMaxError << ", mapping latency " <<
+		mVerificationLatency << " ns" << endl;
+	app::console() << "mean error per grid cell:" << endl << fixed << setprecision( 2 );
+	for ( int y = 0; y < cellsY; y++ )
+	{
+		for ( int x = 0; x < cellsX; x++ )
+		{
+			float &e = mVerificationCellErrors[ x + y * cellsX ];
+			if ( cellCounts[ x + y * cellsX ] > 0 )
+			{
+				e /= cellCounts[ x + y * cellsX ];
+				app::console() << setw( 9 ) << e;
+			}
+			else
+			{
+				e = -1.f;
+				app::console() << setw( 9 ) << "-";
+			}
+		}
+		app::console() << endl;
+	}
+	app::console().unsetf( ios_base::floatfield );
+
+	mShowVerification = true;
+}
+
 void ManualCalibration::update()
 {
+	if ( mIsVerifying )
+	{
+		if ( mLastCalibrationIndexReceived == (int)mVerificationIndex )
+		{
+			Vec2f mapped;
+			Timer timer;
+			timer.start();
+			for ( int i = 0; i < LATENCY_REPEATS; i++ )
+				mapped = map( mCalibrationPos );
+			timer.stop();
+
+			// the error is measured in output coordinates, in canvas pixels
+			// when the output rectangle is the canvas
+			VerificationSample sample;
+			sample.mTarget = mVerificationTargets[ mVerificationIndex ];
+			sample.mMeasured = Vec2f( ( mapped.x - mOutputRect.x1 ) / mOutputRect.getWidth(),
+									  ( mapped.y - mOutputRect.y1 ) / mOutputRect.getHeight() );
+			sample.mError = mapped.distance( toOutput( sample.mTarget ) );
+			sample.mLatency = timer.getSeconds() / LATENCY_REPEATS;
+			mVerificationSamples.push_back( sample );
+
+			mVerificationIndex++;
+			if ( mVerificationIndex >= mVerificationTargets.size() )
+				toggleVerificationCB();
+		}
+		return;
+	}
+
 	if ( !mIsCalibrating )
+	{
+		if ( ( mModel != mModelBuilt ) || ( mHomographyThreshold != mHomographyBuiltThreshold ) )
+			setupTriangleGrid();
+		else
+		if ( mLutResolution != mLutBuiltResolution )
+			setupLookupTable();
 		return;
+	}
 
 	if ( mLastCalibrationIndexReceived == mCalibrationGridIndex )
 	{
@@ -161,47 +444,206 @@ void ManualCalibration::update()
 		{
 			toggleCalibrationCB();
 			setupTriangleGrid();
+
+			app::console() << "homography residuals:" << endl << fixed << setprecision( 5 );
+			for ( int y = 0; y < mGridSize.y; y++ )
+			{
+				for ( int x = 0; x < mGridSize.x; x++ )
+					app::console() << setw( 9 ) << mHomographyResiduals[ x + y * mGridSize.x ];
+				app::console() << endl;
+			}
+			app::console() << "max " << mHomographyMaxResidual << ", mapping with " <<
+				( mUseHomography ? "homography" : "triangles" ) << endl;
+			app::console().unsetf( ios_base::floatfield );
 		}
 	}
 }
 
 Vec2f ManualCalibration::map( const ci::Vec2f &p )
 {
-	// TODO: optimize this with a lookup table maybe?
-
-	float closestDistance = FLT_MAX;
-	vector< Trianglef >::const_iterator closestIt = mCameraTriangleGrid.begin();
-	vector< Trianglef >::const_iterator closestCit = mTriangleGrid.begin();
+	if ( ( p.x < 0.f ) || ( p.x > 1.f ) || ( p.y < 0.f ) || ( p.y > 1.f ) ||
+		 mLut.empty() )
+		return mapExact( p );
+
+	int n = mLutBuiltResolution;
+	float fx = p.x * n;
+	float fy = p.y * n;
+	int x = math< int >::min( (int)fx, n - 1 );
+	int y = math< int >::min( (int)fy, n - 1 );
+	float u = fx - x;
+	float v = fy - y;
+
+	const Vec2f *c = &mLut[ x + y * ( n + 1 ) ];
+	Vec2f top = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+	c += n + 1;
+	Vec2f bottom = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+	return top + v * ( bottom - top );
+}
 
-	for ( vector< Trianglef >::const_iterator it = mCameraTriangleGrid.begin(),
-			cit = mTriangleGrid.begin();
-			it != mCameraTriangleGrid.end(); ++it, ++cit )
+void ManualCalibration::map( const Vec2f *src, Vec2f *dst, size_t count )
+{
+	size_t i = 0;
+	if ( !mLut.empty() )
 	{
-		if ( it->contains( p ) )
+		for ( ; i + 4 <= count; i += 4 )
 		{
-			Vec3f bary = it->toBarycentric( p );
-			return cit->fromBarycentric( bary );
+			if ( !mapLut4( src + i, dst + i ) )
+			{
+				for ( size_t j = i; j < i + 4; j++ )
+					dst[ j ] = map( src[ j ] );
+			}
 		}
+	}
 
-		float d = it->distanceSquared( p );
-		if ( d < closestDistance )
-		{
-			closestDistance = d;
-			closestIt = it;
-			closestCit = cit;
-		}
+	for ( ; i < count; i++ )
+		dst[ i ] = map( src[ i ] );
+}
+
+bool ManualCalibration::mapLut4( const Vec2f *src, Vec2f *dst ) const
+{
+	int n = mLutBuiltResolution;
+#if defined( MNDL_SSE2 )
+	// same operations as map(), on four points at once
+	__m128 p01 = _mm_loadu_ps( &src[ 0 ].x );
+	__m128 p23 = _mm_loadu_ps( &src[ 2 ].x );
+	__m128 px = _mm_shuffle_ps( p01, p23, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+	__m128 py = _mm_shuffle_ps( p01, p23, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps( 1.f );
+	__m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( px, zero ), _mm_cmple_ps( px, one ) ),
+								_mm_and_ps( _mm_cmpge_ps( py, zero ), _mm_cmple_ps( py, one ) ) );
+	if ( _mm_movemask_ps( inside ) != 0xf )
+		return false;
+
+	__m128 size = _mm_set1_ps( (float)n );
+	__m128 maxCell = _mm_set1_ps( (float)( n - 1 ) );
+	__m128 fx = _mm_mul_ps( px, size );
+	__m128 fy = _mm_mul_ps( py, size );
+	__m128 x = _mm_min_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( fx ) ), maxCell );
+	__m128 y = _mm_min_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( fy ) ), maxCell );
+	__m128 u = _mm_sub_ps( fx, x );
+	__m128 v = _mm_sub_ps( fy, y );
+
+	// load the two top and the two bottom corners of each cell and
+	// transpose them to x and y of the corners of the four cells
+	__m128i index = _mm_cvttps_epi32( _mm_add_ps( x, _mm_mul_ps( y, _mm_set1_ps( (float)( n + 1 ) ) ) ) );
+	int32_t indices[ 4 ];
+	_mm_storeu_si128( (__m128i *)indices, index );
+	const Vec2f *c0 = &mLut[ indices[ 0 ] ];
+	const Vec2f *c1 = &mLut[ indices[ 1 ] ];
+	const Vec2f *c2 = &mLut[ indices[ 2 ] ];
+	const Vec2f *c3 = &mLut[ indices[ 3 ] ];
+	__m128 t0x = _mm_loadu_ps( &c0[ 0 ].x );
+	__m128 t0y = _mm_loadu_ps( &c1[ 0 ].x );
+	__m128 t1x = _mm_loadu_ps( &c2[ 0 ].x );
+	__m128 t1y = _mm_loadu_ps( &c3[ 0 ].x );
+	_MM_TRANSPOSE4_PS( t0x, t0y, t1x, t1y );
+	__m128 b0x = _mm_loadu_ps( &c0[ n + 1 ].x );
+	__m128 b0y = _mm_loadu_ps( &c1[ n + 1 ].x );
+	__m128 b1x = _mm_loadu_ps( &c2[ n + 1 ].x );
+	__m128 b1y = _mm_loadu_ps( &c3[ n + 1 ].x );
+	_MM_TRANSPOSE4_PS( b0x, b0y, b1x, b1y );
+
+	__m128 topX = _mm_add_ps( t0x, _mm_mul_ps( u, _mm_sub_ps( t1x, t0x ) ) );
+	__m128 topY = _mm_add_ps( t0y, _mm_mul_ps( u, _mm_sub_ps( t1y, t0y ) ) );
+	__m128 bottomX = _mm_add_ps( b0x, _mm_mul_ps( u, _mm_sub_ps( b1x, b0x ) ) );
+	__m128 bottomY = _mm_add_ps( b0y, _mm_mul_ps( u, _mm_sub_ps( b1y, b0y ) ) );
+	__m128 rx = _mm_add_ps( topX, _mm_mul_ps( v, _mm_sub_ps( bottomX, topX ) ) );
+	__m128 ry = _mm_add_ps( topY, _mm_mul_ps( v, _mm_sub_ps( bottomY, topY ) ) );
+
+	_mm_storeu_ps( &dst[ 0 ].x, _mm_unpacklo_ps( rx, ry ) );
+	_mm_storeu_ps( &dst[ 2 ].x, _mm_unpackhi_ps( rx, ry ) );
+#else
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( ( src[ i ].x < 0.f ) || ( src[ i ].x > 1.f ) ||
+			 ( src[ i ].y < 0.f ) || ( src[ i ].y > 1.f ) )
+			return false;
 	}
 
-	// point is outside of the grid
-	// map position according to closest triangle
-	Vec3f bary = closestIt->toBarycentric( p );
-	return closestCit->fromBarycentric( bary );
+	for ( int i = 0; i < 4; i++ )
+	{
+		float fx = src[ i ].x * n;
+		float fy = src[ i ].y * n;
+		int x = math< int >::min( (int)fx, n - 1 );
+		int y = math< int >::min( (int)fy, n - 1 );
+		float u = fx - x;
+		float v = fy - y;
+
+		const Vec2f *c = &mLut[ x + y * ( n + 1 ) ];
+		Vec2f top = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+		c += n + 1;
+		Vec2f bottom = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+		dst[ i ] = top + v * ( bottom - top );
+	}
+#endif
+	return true;
+}
+
+Vec2f ManualCalibration::mapExact( const ci::Vec2f &p )
+{
+	if ( !mSpline.isFitted() )
+		return mUseHomography ? mapHomography( p ) : mapTriangles( p );
+
+	return toOutput( mSpline.map( p ) );
+}
+
+Vec2f ManualCalibration::mapHomography( const ci::Vec2f &p )
+{
+	Vec2f q = mHomography.map( p );
+
+	// the calibration grid is regular in normalized coordinates, the
+	// residuals are interpolated bilinearly at the mapped point
+	int cellsX = mHomographyGridSize.x - 1;
+	int cellsY = mHomographyGridSize.y - 1;
+	float fx = math< float >::clamp( q.x, 0.f, 1.f ) * cellsX;
+	float fy = math< float >::clamp( q.y, 0.f, 1.f ) * cellsY;
+	int x = math< int >::min( (int)fx, cellsX - 1 );
+	int y = math< int >::min( (int)fy, cellsY - 1 );
+	float u = fx - x;
+	float v = fy - y;
+
+	const Vec2f *c = &mHomographyCorrections[ x + y * mHomographyGridSize.x ];
+	Vec2f top = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+	c += mHomographyGridSize.x;
+	Vec2f bottom = c[ 0 ] + u * ( c[ 1 ] - c[ 0 ] );
+	return toOutput( q + top + v * ( bottom - top ) );
+}
+
+Vec2f ManualCalibration::mapTriangles( const ci::Vec2f &p )
+{
+	// points outside of the grid are mapped according to the closest triangle
+	int32_t t = mCameraLocator.locateClosest( p );
+	if ( t < 0 )
+		return p;
+
+	const TriangleMapping &m = mTriangleMappings[ t ];
+	return Vec2f( m.mX.x * p.x + m.mX.y * p.y + m.mX.z,
+				  m.mY.x * p.x + m.mY.y * p.y + m.mY.z );
 }
 
 void ManualCalibration::draw()
 {
 	RectMapping calibMapping( Rectf( 0, 0, 1, 1 ), app::getWindowBounds() );
 
+	if ( mIsVerifying )
+	{
+		gl::clear( Color::black() );
+		float radius = app::getWindowHeight() / ( 2. * mCalibrationGrid.size() );
+		for ( size_t i = 0; i <= mVerificationIndex && i < mVerificationTargets.size(); i++ )
+		{
+			if ( i < mVerificationIndex )
+				gl::color( Color( 0, 1, 0 ) );
+			else
+				if ( !mRejectBlobs )
+					gl::color( Color( 1, .8, .1 ) );
+				else
+					gl::color( Color::gray( .8 ) );
+			gl::drawSolidCircle( calibMapping.map( mVerificationTargets[ i ] ), radius );
+		}
+	}
+	else
 	if ( mIsCalibrating )
 	{
 		gl::clear( Color::black() );
@@ -221,26 +663,27 @@ void ManualCalibration::draw()
 	else
 	if ( mIsDebugging )
 	{
-		bool hasBlobs = mBlobTrackerRef->getBlobNum() > 0;
 		Vec2f pos;
-		if ( hasBlobs )
+		int32_t hit = -1;
+		if ( mBlobTrackerRef->getBlobNum() > 0 )
+		{
 			pos = mBlobTrackerRef->getBlobCentroid( 0 );
+			hit = mCameraLocator.locate( pos );
+		}
 
-		for ( vector< Trianglef >::const_iterator it = mCameraTriangleGrid.begin(),
-			    cit = mTriangleGrid.begin();
-				it != mCameraTriangleGrid.end(); ++it, ++cit )
+		for ( vector< BarycentricTrianglef >::const_iterator it = mCameraTriangleGrid.begin();
+				it != mCameraTriangleGrid.end(); ++it )
 		{
-			if ( hasBlobs && it->contains( pos ) )
+			if ( it - mCameraTriangleGrid.begin() == hit )
 			{
 				gl::color( ColorA( 1, 0, 0, .5 ) );
 				gl::drawSolidTriangle( calibMapping.map( it->a() ),
 						calibMapping.map( it->b() ),
 						calibMapping.map( it->c() ) );
 
-				Vec3f bary = it->toBarycentric( pos );
-				Vec2f p = cit->fromBarycentric( bary );
+				RectMapping outputMapping( mOutputRect, app::getWindowBounds() );
 				gl::color( ColorA( 1, .6, .1, .5 ) );
-				gl::drawSolidCircle( calibMapping.map( p ), 10 );
+				gl::drawSolidCircle( outputMapping.map( map( pos ) ), 10 );
 			}
 			else
 			{
@@ -251,16 +694,72 @@ void ManualCalibration::draw()
 			}
 		}
 	}
+
+	if ( mShowVerification && !mIsCalibrating && !mIsVerifying )
+		drawVerification( calibMapping );
 	gl::color( Color::white() );
 }
 
-void ManualCalibration::blobsBegan( BlobEvent event )
+void ManualCalibration::drawVerification( const RectMapping &calibMapping )
+{
+	// grid cells colored from green to red by their mean error
+	int cellsX = mGridSize.x - 1;
+	int cellsY = mGridSize.y - 1;
+	if ( mVerificationCellErrors.size() == (size_t)( cellsX * cellsY ) )
+	{
+		for ( int y = 0; y < cellsY; y++ )
+		{
+			for ( int x = 0; x < cellsX; x++ )
+			{
+				float e = mVerificationCellErrors[ x + y * cellsX ];
+				if ( e < 0.f )
+					continue;
+				float t = ( mVerificationMaxError > 0.f ) ? e / mVerificationMaxError : 0.f;
+				gl::color( ColorA( t, 1.f - t, 0.f, .4f ) );
+				Rectf cell( x / (float)cellsX, y / (float)cellsY,
+							( x + 1 ) / (float)cellsX, ( y + 1 ) / (float)cellsY );
+				gl::drawSolidRect( calibMapping.map( cell ) );
+			}
+		}
+	}
+
+	// error vectors from the targets to the measured positions
+	for ( vector< VerificationSample >::const_iterator it = mVerificationSamples.begin();
+			it != mVerificationSamples.end(); ++it )
+	{
+		Vec2f target = calibMapping.map( it->mTarget );
+		gl::color( Color::white() );
+		gl::drawStrokedCircle( target, 5 );
+		gl::color( Color( 1, 0, 0 ) );
+		gl::drawLine( target, calibMapping.map( it->mMeasured ) );
+	}
+}
+
+void ManualCalibration::benchmarkCB()
+{
+	vector< CalibrationBenchmark::Result > results = CalibrationBenchmark::run( *this );
+	CalibrationBenchmark::print( results, app::console() );
+	vector< CalibrationBenchmark::TriangleResult > triangleResults = CalibrationBenchmark::runTriangles();
+	CalibrationBenchmark::print( triangleResults, app::console() );
+	triangleResults = CalibrationBenchmark::runTriangleBatch();
+	CalibrationBenchmark::print( triangleResults, app::console() );
+}
+
+void ManualCalibration::blobsFrame( const BlobFrameEvent &event )
 {
+	BlobEventRange began = event.getBegan();
+	for ( BlobEventRange::const_iterator it = began.begin(); it != began.end(); ++it )
+		blobsBegan( *it );
+}
+
+void ManualCalibration::blobsBegan( const BlobEvent &event )
+{
+	int index = mIsVerifying ? (int)mVerificationIndex : (int)mCalibrationGridIndex;
 	if ( ( !mRejectBlobs ) &&
-		 ( mLastCalibrationIndexReceived < (int)mCalibrationGridIndex ) &&
+		 ( mLastCalibrationIndexReceived < index ) &&
 		 ( mCalibrationId != event.getId() ) )
 	{
-		mLastCalibrationIndexReceived = mCalibrationGridIndex;
+		mLastCalibrationIndexReceived = index;
 		mCalibrationPos = event.getPos();
 		mCalibrationId = event.getId();
 
@@ -270,7 +769,7 @@ void ManualCalibration::blobsBegan( BlobEvent event )
 	}
 }
 
-void ManualCalibration::load( const fs::path &fname )
+bool ManualCalibration::load( const fs::path &fname )
 {
 	fs::path path = fname;
 
@@ -291,7 +790,11 @@ void ManualCalibration::load( const fs::path &fname )
 	mConfigFile = path;
 
 	if ( !fs::exists( path ) )
-		return;
+		return false;
+
+	uint64_t key = CalibrationCache::hashFile( path );
+	if ( loadCache( key ) )
+		return true;
 
 	XmlTree config( loadFile( path ) );
 
@@ -299,7 +802,7 @@ void ManualCalibration::load( const fs::path &fname )
 	mCalibrationGridSize.x = grid.getAttributeValue< int >( "width" );
 	mCalibrationGridSize.y = grid.getAttributeValue< int >( "height" );
 
-	resetGrid();
+	setupCalibrationGrid();
 	mCameraCalibrationGrid.clear();
 
 	for( XmlTree::Iter pit = config.begin( "calibration/point");
@@ -309,7 +812,13 @@ void ManualCalibration::load( const fs::path &fname )
 					 pit->getAttributeValue< float >( "y" ) );
 		mCameraCalibrationGrid.push_back( point );
 	}
+	// a calibration saved unfinished does not cover the grid
+	if ( mCameraCalibrationGrid.size() != mCalibrationGrid.size() )
+		return false;
+
 	setupTriangleGrid();
+	saveCache( key );
+	return true;
 }
 
 void ManualCalibration::save()
@@ -317,8 +826,8 @@ void ManualCalibration::save()
 	XmlTree config( "calibration", "" );
 
 	XmlTree grid( "grid", "" );
-	grid.setAttribute( "width", mCalibrationGridSize.x );
-	grid.setAttribute( "height", mCalibrationGridSize.y );
+	grid.setAttribute( "width", mGridSize.x );
+	grid.setAttribute( "height", mGridSize.y );
 
 	config.push_back( grid );
 
@@ -331,7 +840,84 @@ void ManualCalibration::save()
 		config.push_back( t );
 	}
 	config.write( writeFile( mConfigFile ) );
+
+	saveCache( CalibrationCache::hashFile( mConfigFile ) );
 }
 
-} // namespace mndl
+fs::path ManualCalibration::getCacheFile() const
+{
+	fs::path path = mConfigFile;
+	return path.replace_extension( ".cache" );
+}
 
+bool ManualCalibration::loadCache( uint64_t key )
+{
+	CalibrationCache::Data data;
+	if ( !CalibrationCache::read( getCacheFile(), key, &data ) )
+		return false;
+
+	// the lookup table depends on the settings and the output rectangle
+	if ( ( data.mModel != mModel ) || ( data.mLutResolution != mLutResolution ) ||
+		 ( data.mHomographyThreshold != mHomographyThreshold ) ||
+		 ( data.mOutputRect.x1 != mOutputRect.x1 ) || ( data.mOutputRect.y1 != mOutputRect.y1 ) ||
+		 ( data.mOutputRect.x2 != mOutputRect.x2 ) || ( data.mOutputRect.y2 != mOutputRect.y2 ) )
+		return false;
+
+	mCalibrationGridSize = data.mGridSize;
+	setupCalibrationGrid();
+	mCameraCalibrationGrid.swap( data.mCameraGrid );
+	setupTriangles();
+
+	mTriangleMappings.resize( mCameraTriangleGrid.size() );
+	const float *c = &data.mTriangleCoefficients[ 0 ];
+	for ( size_t i = 0; i < mTriangleMappings.size(); i++, c += 6 )
+	{
+		mTriangleMappings[ i ].mX = Vec3f( c[ 0 ], c[ 1 ], c[ 2 ] );
+		mTriangleMappings[ i ].mY = Vec3f( c[ 3 ], c[ 4 ], c[ 5 ] );
+	}
+
+	// the fits are cheap compared to baking the lookup table
+	setupHomography();
+	setupSpline();
+
+	mLut.swap( data.mLut );
+	mLutBuiltResolution = data.mLutResolution;
+	mLutMaxError = data.mLutMaxError;
+	return true;
+}
+
+void ManualCalibration::saveCache( uint64_t key )
+{
+	// an unfinished calibration or a lookup table of other settings is
+	// not cached, it is rebuilt from the calibration file next time
+	if ( ( mCameraCalibrationGrid.size() != mCalibrationGrid.size() ) ||
+		 ( mModelBuilt != mModel ) || ( mLutBuiltResolution != mLutResolution ) ||
+		 ( mHomographyBuiltThreshold != mHomographyThreshold ) )
+		return;
+
+	CalibrationCache::Data data;
+	data.mGridSize = mGridSize;
+	data.mModel = mModel;
+	data.mLutResolution = mLutBuiltResolution;
+	data.mHomographyThreshold = mHomographyThreshold;
+	data.mOutputRect = mOutputRect;
+	data.mLutMaxError = mLutMaxError;
+	data.mCameraGrid = mCameraCalibrationGrid;
+	data.mTriangleCoefficients.reserve( mTriangleMappings.size() * 6 );
+	for ( vector< TriangleMapping >::const_iterator it = mTriangleMappings.begin();
+			it != mTriangleMappings.end(); ++it )
+	{
+		data.mTriangleCoefficients.push_back( it->mX.x );
+		data.mTriangleCoefficients.push_back( it->mX.y );
+		data.mTriangleCoefficients.push_back( it->mX.z );
+		data.mTriangleCoefficients.push_back( it->mY.x );
+		data.mTriangleCoefficients.push_back( it->mY.y );
+		data.mTriangleCoefficients.push_back( it->mY.z );
+	}
+	data.mLut = mLut;
+
+	if ( !CalibrationCache::write( getCacheFile(), key, data ) )
+		app::console() << "Unable to write calibration cache " << getCacheFile() << endl;
+}
+
+} // namespace mndl
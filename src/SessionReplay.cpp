@@ -0,0 +1,175 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <iomanip>
+
+#include "cinder/app/App.h"
+#include "cinder/CinderMath.h"
+#include "cinder/Rect.h"
+#include "cinder/Timer.h"
+#include "cinder/qtime/QuickTime.h"
+
+#include "BlobTracker.h"
+#include "SessionReplay.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+vector< SessionReplay::Result > SessionReplay::run( const BlobTracker &config, const fs::path &folder,
+													float tolerance, bool record )
+{
+	vector< fs::path > movies;
+	for ( fs::directory_iterator it( folder ); it != fs::directory_iterator(); ++it )
+	{
+		if ( fs::is_regular_file( it->path() ) && ( it->path().extension() == ".mov" ) )
+			movies.push_back( it->path() );
+	}
+	sort( movies.begin(), movies.end() );
+
+	vector< Result > results;
+	for ( vector< fs::path >::const_iterator it = movies.begin(); it != movies.end(); ++it )
+	{
+		SessionReplay replayer;
+		Result result;
+		if ( replayer.replay( config, *it, tolerance, record, &result ) )
+			results.push_back( result );
+		else
+			app::console() << "Unable to replay movie " << *it << endl;
+	}
+	return results;
+}
+
+void SessionReplay::print( const vector< Result > &results, ostream &out )
+{
+	size_t failed = 0;
+	size_t recorded = 0;
+	for ( vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		const BlobEventLog::Diff &diff = it->mDiff;
+
+		out << it->mSession.filename().string() << ": " << it->mFrames << " frames, " <<
+			fixed << setprecision( 1 ) << it->mFps << " fps replay, " <<
+			it->mTrackingFps << " fps tracking, ";
+		if ( it->mRecorded )
+		{
+			out << "golden log recorded" << endl;
+			recorded++;
+			continue;
+		}
+		if ( it->mGoldenMissing )
+		{
+			out << "FAILED (no golden log)" << endl;
+			failed++;
+			continue;
+		}
+
+		if ( diff.passed() )
+		{
+			out << "passed";
+		}
+		else
+		{
+			out << "FAILED";
+			failed++;
+		}
+		out << " (" << diff.mEvents << "/" << diff.mGoldenEvents << " events, " <<
+			diff.mMissing << " missing, " << diff.mExtra << " extra, " <<
+			diff.mMoved << " moved, max error " << setprecision( 5 ) << diff.mMaxError << ")" << endl;
+
+		for ( vector< string >::const_iterator mit = diff.mMessages.begin(); mit != diff.mMessages.end(); ++mit )
+			out << "  " << *mit << endl;
+	}
+	out << results.size() << " sessions replayed, " << recorded << " recorded, " <<
+		failed << " failed" << endl;
+}
+
+bool SessionReplay::replay( const BlobTracker &config, const fs::path &moviePath,
+							float tolerance, bool record, Result *result )
+{
+	qtime::MovieSurface movie;
+	try
+	{
+		movie = qtime::MovieSurface( moviePath );
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	// the tracker is not set up, it does not capture or draw
+	BlobTracker tracker;
+	tracker.copyTrackingSettings( config );
+	tracker.mNormMapping = RectMapping( Rectf( 0.0f, 0.0f, (float)movie.getWidth(), (float)movie.getHeight() ),
+										Rectf( 0.0f, 0.0f, 1.0f, 1.0f ) );
+	tracker.registerBlobsFrame< SessionReplay >( &SessionReplay::blobsFrame, this );
+
+	// step through the frames independently of the playback speed,
+	// frame times are derived from the frame rate for the coasting timeouts
+	float frameRate = movie.getFramerate();
+	if ( frameRate <= 0.f )
+		frameRate = 25.f;
+	int32_t numFrames = movie.getNumFrames();
+
+	Timer replayTimer( true );
+	double trackingSeconds = 0.;
+	for ( mFrame = 0; (int32_t)mFrame < numFrames; mFrame++ )
+	{
+		movie.seekToFrame( mFrame );
+		Surface8u surface = movie.getSurface();
+		if ( !surface )
+			continue;
+
+		Timer trackingTimer( true );
+		tracker.detectBlobs( surface, tracker.getDetectionSettings(), mFrame / (double)frameRate );
+		trackingTimer.stop();
+		trackingSeconds += trackingTimer.getSeconds();
+	}
+	replayTimer.stop();
+
+	result->mSession = moviePath;
+	result->mFrames = mFrame;
+	result->mFps = mFrame / math< double >::max( replayTimer.getSeconds(), 1e-9 );
+	result->mTrackingFps = mFrame / math< double >::max( trackingSeconds, 1e-9 );
+
+	fs::path goldenPath = moviePath;
+	goldenPath.replace_extension( ".events" );
+	result->mRecorded = false;
+	result->mGoldenMissing = false;
+	if ( record )
+	{
+		result->mRecorded = mLog.write( goldenPath );
+		result->mGoldenMissing = !result->mRecorded;
+		return true;
+	}
+
+	BlobEventLog golden;
+	if ( golden.load( goldenPath ) )
+		result->mDiff = mLog.compare( golden, tolerance );
+	else
+		result->mGoldenMissing = true;
+	return true;
+}
+
+void SessionReplay::blobsFrame( const BlobFrameEvent &event )
+{
+	mLog.add( mFrame, event );
+}
+
+} // namespace mndl
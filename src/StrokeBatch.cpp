@@ -0,0 +1,273 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cinder/app/App.h"
+#include "cinder/CinderMath.h"
+
+#include "Resources.h"
+#include "StrokeBatch.h"
+#include "StrokeTessellator.h"
+
+using namespace ci;
+using namespace std;
+
+StrokeBatch::StrokeBatch() :
+	mRenderer( RENDERER_GEOMETRY_SHADER ),
+	mCapacity( 0 ),
+	mLimit( 0.75f )
+{
+}
+
+void StrokeBatch::setup()
+{
+	try
+	{
+		mShader = gl::GlslProg( app::loadResource( RES_STROKE_VERT ),
+								app::loadResource( RES_STROKE_FRAG ),
+								app::loadResource( RES_STROKE_GEOM ),
+								GL_LINES_ADJACENCY_EXT, GL_TRIANGLE_STRIP, 7 );
+	}
+	catch( const std::exception &e )
+	{
+		app::console() << e.what() << std::endl;
+	}
+
+	if ( !gl::isExtensionAvailable( "GL_ARB_draw_instanced" ) ||
+		 !gl::isExtensionAvailable( "GL_ARB_instanced_arrays" ) )
+	{
+		app::console() << "Instancing is not supported, capsule strokes are not available." << std::endl;
+		return;
+	}
+
+	try
+	{
+		mCapsuleShader = gl::GlslProg( app::loadResource( RES_STROKE_CAPSULE_VERT ),
+									   app::loadResource( RES_STROKE_CAPSULE_FRAG ) );
+	}
+	catch( const std::exception &e )
+	{
+		app::console() << e.what() << std::endl;
+		return;
+	}
+
+	const Vec2f corners[ 4 ] = { Vec2f( -1, -1 ), Vec2f( 1, -1 ), Vec2f( -1, 1 ), Vec2f( 1, 1 ) };
+	mQuadVbo = gl::Vbo( GL_ARRAY_BUFFER );
+	mQuadVbo.bind();
+	mQuadVbo.bufferData( sizeof( corners ), corners, GL_STATIC_DRAW );
+	mQuadVbo.unbind();
+}
+
+void StrokeBatch::add( Stroke &stroke )
+{
+	size_t segments = stroke.getNumSegments();
+	size_t drawn = stroke.getSegmentsDrawn();
+	if ( segments <= drawn )
+		return;
+
+	// the last segment drawn before ended with the extrapolated adjacency
+	// vertex, it is drawn again with the actual next point to complete the join
+	size_t first = ( drawn > 0 ) ? drawn - 1 : 0;
+
+	const vector< Vec2f > &vertices = stroke.getVertices();
+	for ( size_t i = first; i < segments; i++ )
+	{
+		mPoints.insert( mPoints.end(), vertices.begin() + i, vertices.begin() + i + 4 );
+		mColors.push_back( stroke.getColor() );
+		mWidths.push_back( stroke.getThickness() );
+		mRedrawn.push_back( i < drawn );
+	}
+
+	stroke.setSegmentsDrawn( segments );
+}
+
+void StrokeBatch::clear()
+{
+	mPoints.clear();
+	mColors.clear();
+	mWidths.clear();
+	mRedrawn.clear();
+}
+
+bool StrokeBatch::isSupported( Renderer renderer ) const
+{
+	switch ( renderer )
+	{
+		case RENDERER_GEOMETRY_SHADER:
+			return mShader;
+		case RENDERER_CAPSULES:
+			return mCapsuleShader;
+		default:
+			return true;
+	}
+}
+
+void StrokeBatch::draw()
+{
+	if ( !mWidths.empty() )
+	{
+		// the tessellator is the fallback where the other renderers are not supported
+		if ( !isSupported( mRenderer ) || ( mRenderer == RENDERER_TESSELLATOR ) )
+			drawTessellated();
+		else
+		if ( mRenderer == RENDERER_CAPSULES )
+			drawCapsules();
+		else
+			drawGeometryShader();
+	}
+
+	clear();
+}
+
+void StrokeBatch::upload( const void *data, size_t size )
+{
+	if ( mCapacity == 0 )
+		mVbo = gl::Vbo( GL_ARRAY_BUFFER );
+	// the capacity only grows, doubled when the data does not fit
+	if ( size > mCapacity )
+		mCapacity = math< size_t >::max( math< size_t >::max( mCapacity * 2, size ), 8192 );
+
+	// orphan the storage of the previous frame, the driver gives a fresh
+	// block instead of waiting for the draws still reading the old one
+	mVbo.bind();
+	mVbo.bufferData( mCapacity, NULL, GL_STREAM_DRAW );
+	mVbo.bufferSubData( 0, size, data );
+}
+
+void StrokeBatch::drawGeometryShader()
+{
+	mVertices.resize( mPoints.size() );
+	for ( size_t i = 0; i < mPoints.size(); i++ )
+	{
+		mVertices[ i ].mPos = mPoints[ i ];
+		mVertices[ i ].mColor = mColors[ i / 4 ];
+		mVertices[ i ].mThickness = mWidths[ i / 4 ];
+	}
+	upload( &mVertices[ 0 ], mVertices.size() * sizeof( Vertex ) );
+
+	mShader.bind();
+	mShader.uniform( "WIN_SCALE", mWindowSize ); // casting to Vec2f is mandatory!
+	mShader.uniform( "MITER_LIMIT", mLimit );
+
+	const GLsizei stride = sizeof( Vertex );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, stride, 0 );
+	glEnableClientState( GL_COLOR_ARRAY );
+	glColorPointer( 4, GL_FLOAT, stride, (const GLvoid *)sizeof( Vec2f ) );
+	glClientActiveTexture( GL_TEXTURE0 );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glTexCoordPointer( 1, GL_FLOAT, stride, (const GLvoid *)( sizeof( Vec2f ) + sizeof( ColorA ) ) );
+
+	glDrawArrays( GL_LINES_ADJACENCY_EXT, 0, mVertices.size() );
+
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	mVbo.unbind();
+
+	mShader.unbind();
+}
+
+void StrokeBatch::drawTessellated()
+{
+	const size_t vps = StrokeTessellator::VERTICES_PER_SEGMENT;
+	size_t segments = mWidths.size();
+	mTriangles.resize( segments * vps );
+	StrokeTessellator::tessellate( &mPoints[ 0 ], &mWidths[ 0 ], segments, mLimit, &mTriangles[ 0 ] );
+
+	mTriangleVertices.resize( mTriangles.size() );
+	for ( size_t i = 0; i < mTriangles.size(); i++ )
+	{
+		mTriangleVertices[ i ].mPos = mTriangles[ i ];
+		mTriangleVertices[ i ].mColor = mColors[ i / vps ];
+	}
+	upload( &mTriangleVertices[ 0 ], mTriangleVertices.size() * sizeof( TriangleVertex ) );
+
+	// fixed function, the colors come from the vertices
+	const GLsizei stride = sizeof( TriangleVertex );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, stride, 0 );
+	glEnableClientState( GL_COLOR_ARRAY );
+	glColorPointer( 4, GL_FLOAT, stride, (const GLvoid *)sizeof( Vec2f ) );
+
+	glDrawArrays( GL_TRIANGLES, 0, mTriangleVertices.size() );
+
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	mVbo.unbind();
+}
+
+void StrokeBatch::drawCapsules()
+{
+	// the joins are round, only the ends of the segments are needed and
+	// the segments drawn before do not change
+	mInstances.clear();
+	for ( size_t i = 0; i < mWidths.size(); i++ )
+	{
+		if ( mRedrawn[ i ] )
+			continue;
+
+		Instance instance;
+		instance.mStart = mPoints[ i * 4 + 1 ];
+		instance.mEnd = mPoints[ i * 4 + 2 ];
+		instance.mColor = mColors[ i ];
+		instance.mWidth = mWidths[ i ];
+		mInstances.push_back( instance );
+	}
+	if ( mInstances.empty() )
+		return;
+
+	upload( &mInstances[ 0 ], mInstances.size() * sizeof( Instance ) );
+
+	mCapsuleShader.bind();
+	GLint segmentLoc = mCapsuleShader.getAttribLocation( "segment" );
+	GLint colorLoc = mCapsuleShader.getAttribLocation( "color" );
+	GLint widthLoc = mCapsuleShader.getAttribLocation( "width" );
+
+	// per instance attributes
+	const GLsizei stride = sizeof( Instance );
+	glEnableVertexAttribArray( segmentLoc );
+	glVertexAttribPointer( segmentLoc, 4, GL_FLOAT, GL_FALSE, stride, 0 );
+	glVertexAttribDivisorARB( segmentLoc, 1 );
+	glEnableVertexAttribArray( colorLoc );
+	glVertexAttribPointer( colorLoc, 4, GL_FLOAT, GL_FALSE, stride, (const GLvoid *)( 2 * sizeof( Vec2f ) ) );
+	glVertexAttribDivisorARB( colorLoc, 1 );
+	glEnableVertexAttribArray( widthLoc );
+	glVertexAttribPointer( widthLoc, 1, GL_FLOAT, GL_FALSE, stride,
+			(const GLvoid *)( 2 * sizeof( Vec2f ) + sizeof( ColorA ) ) );
+	glVertexAttribDivisorARB( widthLoc, 1 );
+	mVbo.unbind();
+
+	// the quad corners are passed as gl_Vertex, some drivers do not draw without it
+	mQuadVbo.bind();
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, 0, 0 );
+
+	glDrawArraysInstancedARB( GL_TRIANGLE_STRIP, 0, 4, mInstances.size() );
+
+	glDisableClientState( GL_VERTEX_ARRAY );
+	mQuadVbo.unbind();
+
+	glVertexAttribDivisorARB( segmentLoc, 0 );
+	glVertexAttribDivisorARB( colorLoc, 0 );
+	glVertexAttribDivisorARB( widthLoc, 0 );
+	glDisableVertexAttribArray( segmentLoc );
+	glDisableVertexAttribArray( colorLoc );
+	glDisableVertexAttribArray( widthLoc );
+
+	mCapsuleShader.unbind();
+}
@@ -0,0 +1,341 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iomanip>
+
+#include "cinder/app/App.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+#include "cinder/Timer.h"
+
+#include "Stroke.h"
+#include "StrokeBatch.h"
+#include "StrokeBenchmark.h"
+#include "StrokeTessellator.h"
+
+using namespace ci;
+using namespace std;
+
+// size of the canvas the strokes are generated on
+static const Vec2f CANVAS_SIZE( 1024, 768 );
+static const float MITER_LIMIT = .75f;
+// maximum vertex distance from the shader math in pixels, the shader works
+// in clip space scaled to pixels, so the rounding differs slightly
+static const float TOLERANCE = 1e-2f;
+
+vector< StrokeBenchmark::Result > StrokeBenchmark::runTessellator( size_t segments )
+{
+	vector< Vec2f > points;
+	vector< float > widths;
+	generateSegments( segments, &points, &widths );
+
+	const size_t vps = StrokeTessellator::VERTICES_PER_SEGMENT;
+	vector< Vec2f > reference( segments * vps );
+	vector< Vec2f > vertices( segments * vps );
+	vector< Result > results;
+	Timer timer;
+
+	Result r;
+	r.mSegments = segments;
+	r.mMethod = "shader math";
+	timer.start();
+	for ( size_t i = 0; i < segments; i++ )
+		shaderSegment( &points[ i * 4 ], widths[ i ], MITER_LIMIT, CANVAS_SIZE, &reference[ i * vps ] );
+	timer.stop();
+	r.mNsPerSegment = timer.getSeconds() * 1e9 / segments;
+	compare( reference, reference, &r );
+	results.push_back( r );
+
+	r.mMethod = "scalar";
+	timer.start();
+	StrokeTessellator::tessellateScalar( &points[ 0 ], &widths[ 0 ], segments, MITER_LIMIT, &vertices[ 0 ] );
+	timer.stop();
+	r.mNsPerSegment = timer.getSeconds() * 1e9 / segments;
+	compare( reference, vertices, &r );
+	results.push_back( r );
+
+	r.mMethod = "tessellate";
+	timer.start();
+	StrokeTessellator::tessellate( &points[ 0 ], &widths[ 0 ], segments, MITER_LIMIT, &vertices[ 0 ] );
+	timer.stop();
+	r.mNsPerSegment = timer.getSeconds() * 1e9 / segments;
+	compare( reference, vertices, &r );
+	results.push_back( r );
+
+	return results;
+}
+
+void StrokeBenchmark::print( const vector< Result > &results, ostream &out )
+{
+	out << setw( 16 ) << left << "method" << right <<
+		setw( 10 ) << "segments" << setw( 12 ) << "ns/segment" <<
+		setw( 12 ) << "max error" << setw( 12 ) << "mismatches" << endl;
+	for ( vector< Result >::const_iterator it = results.begin();
+			it != results.end(); ++it )
+	{
+		out << setw( 16 ) << left << it->mMethod << right <<
+			setw( 10 ) << it->mSegments <<
+			setw( 12 ) << fixed << setprecision( 1 ) << it->mNsPerSegment <<
+			setw( 12 ) << scientific << setprecision( 2 ) << it->mMaxError <<
+			setw( 12 ) << it->mMismatches << endl;
+	}
+	out.unsetf( ios_base::floatfield );
+}
+
+vector< StrokeBenchmark::RendererResult > StrokeBenchmark::runRenderers( const Vec2i &size,
+		size_t segments, size_t frames )
+{
+	vector< Stroke > strokes = generateStrokes( segments, Vec2f( size ) );
+	segments = 0;
+	for ( vector< Stroke >::const_iterator it = strokes.begin(); it != strokes.end(); ++it )
+		segments += it->getNumSegments();
+
+	StrokeBatch batch;
+	batch.setup();
+	batch.resize( size );
+
+	const char *names[] = { "geometry shader", "tessellator", "capsules", "capsules no msaa" };
+	const StrokeBatch::Renderer renderers[] = { StrokeBatch::RENDERER_GEOMETRY_SHADER,
+		StrokeBatch::RENDERER_TESSELLATOR, StrokeBatch::RENDERER_CAPSULES,
+		StrokeBatch::RENDERER_CAPSULES };
+	// the drawing of the app is multisampled, the capsules do not need it
+	const int samples[] = { 4, 4, 4, 0 };
+
+	vector< RendererResult > results;
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		if ( !batch.isSupported( renderers[ i ] ) )
+		{
+			app::console() << names[ i ] << " renderer is not supported" << endl;
+			continue;
+		}
+		batch.setRenderer( renderers[ i ] );
+
+		gl::Fbo::Format format;
+		format.enableDepthBuffer( false );
+		format.setSamples( samples[ i ] );
+		gl::Fbo fbo( size.x, size.y, format );
+
+		fbo.bindFramebuffer();
+		gl::setMatricesWindow( fbo.getSize(), false );
+		gl::setViewport( fbo.getBounds() );
+		gl::enableAlphaBlending();
+
+		// the first frame is not measured
+		Timer timer;
+		for ( size_t f = 0; f <= frames; f++ )
+		{
+			if ( f == 1 )
+			{
+				glFinish();
+				timer.start();
+			}
+
+			gl::clear( ColorA( 1, 1, 1, 0 ) );
+			for ( vector< Stroke >::iterator it = strokes.begin(); it != strokes.end(); ++it )
+			{
+				it->setSegmentsDrawn( 0 );
+				batch.add( *it );
+			}
+			batch.draw();
+		}
+		glFinish();
+		timer.stop();
+
+		gl::disableAlphaBlending();
+		fbo.unbindFramebuffer();
+
+		RendererResult r;
+		r.mRenderer = names[ i ];
+		r.mSegments = segments;
+		r.mMsPerFrame = timer.getSeconds() * 1e3 / frames;
+		r.mNsPerSegment = timer.getSeconds() * 1e9 / ( frames * segments );
+		results.push_back( r );
+	}
+
+	return results;
+}
+
+void StrokeBenchmark::print( const vector< RendererResult > &results, ostream &out )
+{
+	out << setw( 18 ) << left << "renderer" << right <<
+		setw( 10 ) << "segments" << setw( 12 ) << "ms/frame" <<
+		setw( 12 ) << "ns/segment" << endl;
+	for ( vector< RendererResult >::const_iterator it = results.begin();
+			it != results.end(); ++it )
+	{
+		out << setw( 18 ) << left << it->mRenderer << right <<
+			setw( 10 ) << it->mSegments <<
+			setw( 12 ) << fixed << setprecision( 2 ) << it->mMsPerFrame <<
+			setw( 12 ) << setprecision( 1 ) << it->mNsPerSegment << endl;
+	}
+	out.unsetf( ios_base::floatfield );
+}
+
+vector< Stroke > StrokeBenchmark::generateStrokes( size_t segments, const Vec2f &size )
+{
+	Rand rnd( 4 );
+	vector< Stroke > strokes;
+	size_t n = 0;
+
+	while ( n < segments )
+	{
+		Stroke stroke;
+		stroke.setThickness( rnd.nextFloat( 1.f, 200.f ) );
+		Vec2f pos( rnd.nextFloat( size.x ), rnd.nextFloat( size.y ) );
+		float angle = rnd.nextFloat( 2 * M_PI );
+		for ( size_t i = 0; i < 100; i++ )
+		{
+			stroke.update( pos );
+
+			// mostly smooth turns with a sharp corner now and then
+			if ( rnd.nextFloat() < .1f )
+				angle += rnd.nextFloat( -M_PI, M_PI );
+			else
+				angle += rnd.nextFloat( -.3f, .3f );
+			pos += Vec2f( math< float >::cos( angle ), math< float >::sin( angle ) ) *
+				rnd.nextFloat( 2.f, 30.f );
+			pos.x = math< float >::clamp( pos.x, 0, size.x );
+			pos.y = math< float >::clamp( pos.y, 0, size.y );
+		}
+
+		n += stroke.getNumSegments();
+		strokes.push_back( stroke );
+	}
+
+	return strokes;
+}
+
+void StrokeBenchmark::generateSegments( size_t segments, vector< Vec2f > *points, vector< float > *widths )
+{
+	points->clear();
+	widths->clear();
+
+	vector< Stroke > strokes = generateStrokes( segments, CANVAS_SIZE );
+	for ( vector< Stroke >::const_iterator it = strokes.begin(); it != strokes.end(); ++it )
+	{
+		const vector< Vec2f > &vertices = it->getVertices();
+		for ( size_t i = 0; ( i < it->getNumSegments() ) && ( widths->size() < segments ); i++ )
+		{
+			points->insert( points->end(), vertices.begin() + i, vertices.begin() + i + 4 );
+			widths->push_back( it->getThickness() );
+		}
+	}
+}
+
+// GLSL helpers of the shader port
+static inline Vec2f normalize( const Vec2f &v )
+{
+	return v / math< float >::sqrt( v.dot( v ) );
+}
+
+void StrokeBenchmark::shaderSegment( const Vec2f *points, float thickness, float miterLimit,
+		const Vec2f &size, Vec2f *out )
+{
+	const float THICKNESS = thickness;
+	const float MITER_LIMIT = miterLimit;
+	const Vec2f WIN_SCALE = size;
+
+	// gl_Position of the vertex shader with the matrices of setMatricesWindow
+	Vec2f positionIn[ 4 ];
+	for ( size_t i = 0; i < 4; i++ )
+		positionIn[ i ] = points[ i ] * 2.f / size - Vec2f( 1, 1 );
+
+	// screen_space()
+	Vec2f p0 = positionIn[ 0 ] * WIN_SCALE;
+	Vec2f p1 = positionIn[ 1 ] * WIN_SCALE;
+	Vec2f p2 = positionIn[ 2 ] * WIN_SCALE;
+	Vec2f p3 = positionIn[ 3 ] * WIN_SCALE;
+
+	Vec2f v0 = normalize( p1 - p0 );
+	Vec2f v1 = normalize( p2 - p1 );
+	Vec2f v2 = normalize( p3 - p2 );
+
+	Vec2f n0( -v0.y, v0.x );
+	Vec2f n1( -v1.y, v1.x );
+	Vec2f n2( -v2.y, v2.x );
+
+	Vec2f miter_a = normalize( n0 + n1 );
+	Vec2f miter_b = normalize( n1 + n2 );
+
+	float length_a = THICKNESS / miter_a.dot( n1 );
+	float length_b = THICKNESS / miter_b.dot( n1 );
+
+	// emitted gl_Position values, the gap triangle is degenerate if not emitted
+	Vec2f position[ StrokeTessellator::VERTICES_PER_SEGMENT ];
+	position[ 0 ] = position[ 1 ] = position[ 2 ] = p1 / WIN_SCALE;
+
+	if ( v0.dot( v1 ) < -MITER_LIMIT )
+	{
+		miter_a = n1;
+		length_a = THICKNESS;
+
+		if ( v0.dot( n1 ) > 0 )
+		{
+			position[ 0 ] = ( p1 + n0 * THICKNESS ) / WIN_SCALE;
+			position[ 1 ] = ( p1 + n1 * THICKNESS ) / WIN_SCALE;
+		}
+		else
+		{
+			position[ 0 ] = ( p1 - n1 * THICKNESS ) / WIN_SCALE;
+			position[ 1 ] = ( p1 - n0 * THICKNESS ) / WIN_SCALE;
+		}
+	}
+
+	if ( v1.dot( v2 ) < -MITER_LIMIT )
+	{
+		miter_b = n1;
+		length_b = THICKNESS;
+	}
+
+	// the triangle strip as two triangles
+	position[ 3 ] = ( p1 + miter_a * length_a ) / WIN_SCALE;
+	position[ 4 ] = ( p1 - miter_a * length_a ) / WIN_SCALE;
+	position[ 5 ] = ( p2 + miter_b * length_b ) / WIN_SCALE;
+	position[ 6 ] = position[ 4 ];
+	position[ 7 ] = position[ 5 ];
+	position[ 8 ] = ( p2 - miter_b * length_b ) / WIN_SCALE;
+
+	for ( size_t i = 0; i < StrokeTessellator::VERTICES_PER_SEGMENT; i++ )
+		out[ i ] = ( position[ i ] + Vec2f( 1, 1 ) ) * size * .5f;
+}
+
+void StrokeBenchmark::compare( const vector< Vec2f > &reference, const vector< Vec2f > &vertices,
+		Result *result )
+{
+	const size_t vps = StrokeTessellator::VERTICES_PER_SEGMENT;
+	result->mMaxError = 0.f;
+	result->mMismatches = 0;
+	for ( size_t i = 0; i < reference.size(); i += vps )
+	{
+		float error = 0.f;
+		for ( size_t j = i; j < i + vps; j++ )
+		{
+			float d = reference[ j ].distance( vertices[ j ] );
+			// a NaN vertex is a mismatch
+			if ( !( d <= error ) )
+				error = d;
+		}
+		if ( !( error <= TOLERANCE ) )
+			result->mMismatches++;
+		if ( error > result->mMaxError )
+			result->mMaxError = error;
+	}
+}
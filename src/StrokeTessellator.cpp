@@ -0,0 +1,220 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cinder/CinderMath.h"
+
+#include "StrokeTessellator.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define MNDL_STROKE_TESSELLATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+static inline Vec2f normalize( const Vec2f &v )
+{
+	float inv = 1.f / math< float >::sqrt( v.x * v.x + v.y * v.y );
+	return Vec2f( v.x * inv, v.y * inv );
+}
+
+void StrokeTessellator::tessellateScalar( const Vec2f *points, const float *widths, size_t count,
+		float miterLimit, Vec2f *out )
+{
+	for ( size_t i = 0; i < count; i++, points += 4, out += VERTICES_PER_SEGMENT )
+	{
+		const Vec2f &p0 = points[ 0 ];
+		const Vec2f &p1 = points[ 1 ];
+		const Vec2f &p2 = points[ 2 ];
+		const Vec2f &p3 = points[ 3 ];
+		float t = .5f * widths[ i ];
+
+		// directions and normals of the previous, current and next segments
+		Vec2f v0 = normalize( p1 - p0 );
+		Vec2f v1 = normalize( p2 - p1 );
+		Vec2f v2 = normalize( p3 - p2 );
+		Vec2f n0( -v0.y, v0.x );
+		Vec2f n1( -v1.y, v1.x );
+		Vec2f n2( -v2.y, v2.x );
+
+		// miters at the start and the end of the current segment
+		Vec2f miterA = normalize( n0 + n1 );
+		Vec2f miterB = normalize( n1 + n2 );
+		float lengthA = t / miterA.dot( n1 );
+		float lengthB = t / miterB.dot( n1 );
+
+		// no miter at sharp corners, the gap at the start is closed by a triangle
+		if ( v0.dot( v1 ) < -miterLimit )
+		{
+			miterA = n1;
+			lengthA = t;
+			if ( v0.dot( n1 ) > 0 )
+			{
+				out[ 0 ] = p1 + n0 * t;
+				out[ 1 ] = p1 + n1 * t;
+			}
+			else
+			{
+				out[ 0 ] = p1 - n1 * t;
+				out[ 1 ] = p1 - n0 * t;
+			}
+		}
+		else
+		{
+			out[ 0 ] = out[ 1 ] = p1;
+		}
+		out[ 2 ] = p1;
+
+		if ( v1.dot( v2 ) < -miterLimit )
+		{
+			miterB = n1;
+			lengthB = t;
+		}
+
+		out[ 3 ] = p1 + miterA * lengthA;
+		out[ 4 ] = p1 - miterA * lengthA;
+		out[ 5 ] = p2 + miterB * lengthB;
+		out[ 6 ] = out[ 4 ];
+		out[ 7 ] = out[ 5 ];
+		out[ 8 ] = p2 - miterB * lengthB;
+	}
+}
+
+#if defined( MNDL_STROKE_TESSELLATOR_SSE2 )
+
+static inline void normalize4( __m128 &x, __m128 &y )
+{
+	__m128 inv = _mm_div_ps( _mm_set1_ps( 1.f ),
+			_mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ) ) );
+	x = _mm_mul_ps( x, inv );
+	y = _mm_mul_ps( y, inv );
+}
+
+static inline __m128 dot4( __m128 ax, __m128 ay, __m128 bx, __m128 by )
+{
+	return _mm_add_ps( _mm_mul_ps( ax, bx ), _mm_mul_ps( ay, by ) );
+}
+
+//! Returns \a a where \a mask is set and \a b elsewhere.
+static inline __m128 select4( __m128 mask, __m128 a, __m128 b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+//! Same operations as tessellateScalar() on four segments at once.
+static void tessellateBlock( const Vec2f *points, const float *widths, float miterLimit, Vec2f *out )
+{
+	// the points of four segments transposed to x and y of p0 - p3
+	const float *in = &points[ 0 ].x;
+	__m128 p01[ 4 ], p23[ 4 ];
+	for ( size_t k = 0; k < 4; k++ )
+	{
+		p01[ k ] = _mm_loadu_ps( in + 8 * k );
+		p23[ k ] = _mm_loadu_ps( in + 8 * k + 4 );
+	}
+	_MM_TRANSPOSE4_PS( p01[ 0 ], p01[ 1 ], p01[ 2 ], p01[ 3 ] );
+	_MM_TRANSPOSE4_PS( p23[ 0 ], p23[ 1 ], p23[ 2 ], p23[ 3 ] );
+	__m128 px[ 4 ] = { p01[ 0 ], p01[ 2 ], p23[ 0 ], p23[ 2 ] };
+	__m128 py[ 4 ] = { p01[ 1 ], p01[ 3 ], p23[ 1 ], p23[ 3 ] };
+
+	__m128 t = _mm_mul_ps( _mm_set1_ps( .5f ), _mm_loadu_ps( widths ) );
+	__m128 limit = _mm_set1_ps( -miterLimit );
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 v0x = _mm_sub_ps( px[ 1 ], px[ 0 ] );
+	__m128 v0y = _mm_sub_ps( py[ 1 ], py[ 0 ] );
+	__m128 v1x = _mm_sub_ps( px[ 2 ], px[ 1 ] );
+	__m128 v1y = _mm_sub_ps( py[ 2 ], py[ 1 ] );
+	__m128 v2x = _mm_sub_ps( px[ 3 ], px[ 2 ] );
+	__m128 v2y = _mm_sub_ps( py[ 3 ], py[ 2 ] );
+	normalize4( v0x, v0y );
+	normalize4( v1x, v1y );
+	normalize4( v2x, v2y );
+	__m128 n0x = _mm_sub_ps( zero, v0y );
+	__m128 n0y = v0x;
+	__m128 n1x = _mm_sub_ps( zero, v1y );
+	__m128 n1y = v1x;
+	__m128 n2x = _mm_sub_ps( zero, v2y );
+	__m128 n2y = v2x;
+
+	__m128 miterAx = _mm_add_ps( n0x, n1x );
+	__m128 miterAy = _mm_add_ps( n0y, n1y );
+	__m128 miterBx = _mm_add_ps( n1x, n2x );
+	__m128 miterBy = _mm_add_ps( n1y, n2y );
+	normalize4( miterAx, miterAy );
+	normalize4( miterBx, miterBy );
+	__m128 lengthA = _mm_div_ps( t, dot4( miterAx, miterAy, n1x, n1y ) );
+	__m128 lengthB = _mm_div_ps( t, dot4( miterBx, miterBy, n1x, n1y ) );
+
+	__m128 sharpA = _mm_cmplt_ps( dot4( v0x, v0y, v1x, v1y ), limit );
+	__m128 sharpB = _mm_cmplt_ps( dot4( v1x, v1y, v2x, v2y ), limit );
+	miterAx = select4( sharpA, n1x, miterAx );
+	miterAy = select4( sharpA, n1y, miterAy );
+	lengthA = select4( sharpA, t, lengthA );
+	miterBx = select4( sharpB, n1x, miterBx );
+	miterBy = select4( sharpB, n1y, miterBy );
+	lengthB = select4( sharpB, t, lengthB );
+
+	// gap triangle, collapsed to p1 where the start is not sharp
+	__m128 side = _mm_cmpgt_ps( dot4( v0x, v0y, n1x, n1y ), zero );
+	__m128 g0x = select4( side, _mm_add_ps( px[ 1 ], _mm_mul_ps( n0x, t ) ), _mm_sub_ps( px[ 1 ], _mm_mul_ps( n1x, t ) ) );
+	__m128 g0y = select4( side, _mm_add_ps( py[ 1 ], _mm_mul_ps( n0y, t ) ), _mm_sub_ps( py[ 1 ], _mm_mul_ps( n1y, t ) ) );
+	__m128 g1x = select4( side, _mm_add_ps( px[ 1 ], _mm_mul_ps( n1x, t ) ), _mm_sub_ps( px[ 1 ], _mm_mul_ps( n0x, t ) ) );
+	__m128 g1y = select4( side, _mm_add_ps( py[ 1 ], _mm_mul_ps( n1y, t ) ), _mm_sub_ps( py[ 1 ], _mm_mul_ps( n0y, t ) ) );
+
+	// rows of the output vertices g0 g1 p1, a0 a1 b0, a1 b0 b1 transposed back
+	__m128 r0[ 4 ] = { select4( sharpA, g0x, px[ 1 ] ), select4( sharpA, g0y, py[ 1 ] ),
+		select4( sharpA, g1x, px[ 1 ] ), select4( sharpA, g1y, py[ 1 ] ) };
+	__m128 r1[ 4 ] = { px[ 1 ], py[ 1 ],
+		_mm_add_ps( px[ 1 ], _mm_mul_ps( miterAx, lengthA ) ), _mm_add_ps( py[ 1 ], _mm_mul_ps( miterAy, lengthA ) ) };
+	__m128 r2[ 4 ] = { _mm_sub_ps( px[ 1 ], _mm_mul_ps( miterAx, lengthA ) ), _mm_sub_ps( py[ 1 ], _mm_mul_ps( miterAy, lengthA ) ),
+		_mm_add_ps( px[ 2 ], _mm_mul_ps( miterBx, lengthB ) ), _mm_add_ps( py[ 2 ], _mm_mul_ps( miterBy, lengthB ) ) };
+	__m128 b1x = _mm_sub_ps( px[ 2 ], _mm_mul_ps( miterBx, lengthB ) );
+	__m128 b1y = _mm_sub_ps( py[ 2 ], _mm_mul_ps( miterBy, lengthB ) );
+	_MM_TRANSPOSE4_PS( r0[ 0 ], r0[ 1 ], r0[ 2 ], r0[ 3 ] );
+	_MM_TRANSPOSE4_PS( r1[ 0 ], r1[ 1 ], r1[ 2 ], r1[ 3 ] );
+	_MM_TRANSPOSE4_PS( r2[ 0 ], r2[ 1 ], r2[ 2 ], r2[ 3 ] );
+	__m128 b1[ 2 ] = { _mm_unpacklo_ps( b1x, b1y ), _mm_unpackhi_ps( b1x, b1y ) };
+
+	float *o = &out[ 0 ].x;
+	for ( size_t k = 0; k < 4; k++, o += 2 * StrokeTessellator::VERTICES_PER_SEGMENT )
+	{
+		_mm_storeu_ps( o, r0[ k ] );
+		_mm_storeu_ps( o + 4, r1[ k ] );
+		_mm_storeu_ps( o + 8, r2[ k ] );
+		_mm_storeu_ps( o + 12, r2[ k ] );
+		if ( k & 1 )
+			_mm_storeh_pi( (__m64 *)( o + 16 ), b1[ k / 2 ] );
+		else
+			_mm_storel_pi( (__m64 *)( o + 16 ), b1[ k / 2 ] );
+	}
+}
+
+#endif
+
+void StrokeTessellator::tessellate( const Vec2f *points, const float *widths, size_t count,
+		float miterLimit, Vec2f *out )
+{
+	size_t i = 0;
+#if defined( MNDL_STROKE_TESSELLATOR_SSE2 )
+	for ( ; i + 4 <= count; i += 4 )
+		tessellateBlock( points + 4 * i, widths + i, miterLimit, out + VERTICES_PER_SEGMENT * i );
+#endif
+	tessellateScalar( points + 4 * i, widths + i, count - i, miterLimit, out + VERTICES_PER_SEGMENT * i );
+}
@@ -0,0 +1,97 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cinder/CinderMath.h"
+
+#include "LinearSystem.h"
+#include "ThinPlateSpline.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+void ThinPlateSpline::clear()
+{
+	mCenters.clear();
+	mWeights.clear();
+	mAffine[ 0 ] = Vec2d( 0., 0. );
+	mAffine[ 1 ] = Vec2d( 1., 0. );
+	mAffine[ 2 ] = Vec2d( 0., 1. );
+}
+
+bool ThinPlateSpline::fit( const vector< Vec2f > &src, const vector< Vec2f > &dst, double smoothing )
+{
+	clear();
+
+	size_t n = src.size();
+	if ( ( n < 3 ) || ( dst.size() != n ) )
+		return false;
+
+	// the system for the kernel weights w and the affine coefficients a is
+	// | K + smoothing * I  P | | w |   | dst |
+	// | P^T              0 | | a | = |  0  |
+	// where K is the kernel of the control point distances and the rows of
+	// P are ( 1, x, y ). It is solved for both coordinates at once, the
+	// right hand sides are the last two columns of the augmented matrix.
+	size_t m = n + 3;
+	size_t stride = m + 2;
+	vector< double > a( m * stride, 0. );
+	for ( size_t i = 0; i < n; i++ )
+	{
+		double *row = &a[ i * stride ];
+		Vec2d pi( src[ i ] );
+		for ( size_t j = 0; j < n; j++ )
+			row[ j ] = kernel( pi.distanceSquared( Vec2d( src[ j ] ) ) );
+		row[ i ] += smoothing;
+		row[ n ] = 1.;
+		row[ n + 1 ] = pi.x;
+		row[ n + 2 ] = pi.y;
+		row[ m ] = dst[ i ].x;
+		row[ m + 1 ] = dst[ i ].y;
+
+		a[ n * stride + i ] = 1.;
+		a[ ( n + 1 ) * stride + i ] = pi.x;
+		a[ ( n + 2 ) * stride + i ] = pi.y;
+	}
+
+	vector< double > x;
+	if ( !solveLinearSystem( a, m, 2, &x ) )
+		return false;
+
+	mCenters.resize( n );
+	mWeights.resize( n );
+	for ( size_t i = 0; i < n; i++ )
+	{
+		mCenters[ i ] = Vec2d( src[ i ] );
+		mWeights[ i ] = Vec2d( x[ i * 2 ], x[ i * 2 + 1 ] );
+	}
+	for ( size_t i = 0; i < 3; i++ )
+		mAffine[ i ] = Vec2d( x[ ( n + i ) * 2 ], x[ ( n + i ) * 2 + 1 ] );
+	return true;
+}
+
+Vec2f ThinPlateSpline::map( const Vec2f &p ) const
+{
+	Vec2d q( p );
+	Vec2d r = mAffine[ 0 ] + mAffine[ 1 ] * q.x + mAffine[ 2 ] * q.y;
+	for ( size_t i = 0; i < mCenters.size(); i++ )
+		r += mWeights[ i ] * kernel( q.distanceSquared( mCenters[ i ] ) );
+	return Vec2f( r );
+}
+
+} // namespace mndl
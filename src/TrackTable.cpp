@@ -0,0 +1,209 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TrackTable.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+TrackTable::TrackTable( size_t capacity )
+{
+	reserve( capacity );
+}
+
+void TrackTable::reserve( size_t capacity )
+{
+	mIds.reserve( capacity );
+	mCentroids.reserve( capacity );
+	mPrevCentroids.reserve( capacity );
+	mBboxes.reserve( capacity );
+	mAreas.reserve( capacity );
+	mVelocities.reserve( capacity );
+	mMergeOffsets.reserve( capacity );
+	mStates.reserve( capacity );
+	mMissedFrames.reserve( capacity );
+	mLastSeen.reserve( capacity );
+	mSlots.reserve( capacity );
+
+	mSlotIndices.reserve( capacity );
+	mSlotGenerations.reserve( capacity );
+	mFreeSlots.reserve( capacity );
+}
+
+void TrackTable::clear()
+{
+	while ( !empty() )
+		removeAt( size() - 1 );
+}
+
+TrackHandle TrackTable::add( const Blob &blob, double time )
+{
+	uint32_t slot;
+	if ( mFreeSlots.empty() )
+	{
+		slot = (uint32_t)mSlotIndices.size();
+		mSlotIndices.push_back( 0 );
+		mSlotGenerations.push_back( 0 );
+	}
+	else
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	mSlotIndices[ slot ] = (uint32_t)mIds.size();
+
+	mIds.push_back( blob.mId );
+	mCentroids.push_back( blob.mCentroid );
+	mPrevCentroids.push_back( blob.mPrevCentroid );
+	mBboxes.push_back( blob.mBbox );
+	mAreas.push_back( blob.mArea );
+	mVelocities.push_back( Vec2f::zero() );
+	mMergeOffsets.push_back( Vec2f::zero() );
+	mStates.push_back( STATE_ACTIVE );
+	mMissedFrames.push_back( 0 );
+	mLastSeen.push_back( time );
+	mSlots.push_back( slot );
+
+	return TrackHandle( slot, mSlotGenerations[ slot ] );
+}
+
+void TrackTable::removeAt( size_t i )
+{
+	size_t last = mIds.size() - 1;
+	uint32_t slot = mSlots[ i ];
+
+	if ( i != last )
+	{
+		mIds[ i ] = mIds[ last ];
+		mCentroids[ i ] = mCentroids[ last ];
+		mPrevCentroids[ i ] = mPrevCentroids[ last ];
+		mBboxes[ i ] = mBboxes[ last ];
+		mAreas[ i ] = mAreas[ last ];
+		mVelocities[ i ] = mVelocities[ last ];
+		mMergeOffsets[ i ] = mMergeOffsets[ last ];
+		mStates[ i ] = mStates[ last ];
+		mMissedFrames[ i ] = mMissedFrames[ last ];
+		mLastSeen[ i ] = mLastSeen[ last ];
+		mSlots[ i ] = mSlots[ last ];
+		mSlotIndices[ mSlots[ i ] ] = (uint32_t)i;
+	}
+
+	mIds.pop_back();
+	mCentroids.pop_back();
+	mPrevCentroids.pop_back();
+	mBboxes.pop_back();
+	mAreas.pop_back();
+	mVelocities.pop_back();
+	mMergeOffsets.pop_back();
+	mStates.pop_back();
+	mMissedFrames.pop_back();
+	mLastSeen.pop_back();
+	mSlots.pop_back();
+
+	// invalidate the handles referring to the slot
+	mSlotGenerations[ slot ]++;
+	mFreeSlots.push_back( slot );
+}
+
+bool TrackTable::remove( const TrackHandle &handle )
+{
+	int32_t i = indexOf( handle );
+	if ( i < 0 )
+		return false;
+
+	removeAt( i );
+	return true;
+}
+
+bool TrackTable::isValid( const TrackHandle &handle ) const
+{
+	return ( handle.mSlot < mSlotGenerations.size() ) &&
+		   ( mSlotGenerations[ handle.mSlot ] == handle.mGeneration ) &&
+		   ( mSlotIndices[ handle.mSlot ] < mIds.size() ) &&
+		   ( mSlots[ mSlotIndices[ handle.mSlot ] ] == handle.mSlot );
+}
+
+int32_t TrackTable::indexOf( const TrackHandle &handle ) const
+{
+	if ( !isValid( handle ) )
+		return -1;
+	return (int32_t)mSlotIndices[ handle.mSlot ];
+}
+
+TrackHandle TrackTable::getHandle( size_t i ) const
+{
+	uint32_t slot = mSlots[ i ];
+	return TrackHandle( slot, mSlotGenerations[ slot ] );
+}
+
+Blob TrackTable::getBlob( size_t i ) const
+{
+	Blob b;
+	b.mId = mIds[ i ];
+	b.mBbox = mBboxes[ i ];
+	b.mCentroid = mCentroids[ i ];
+	b.mPrevCentroid = mPrevCentroids[ i ];
+	b.mArea = mAreas[ i ];
+	return b;
+}
+
+void TrackTable::update( size_t i, const Blob &blob, double time )
+{
+	// store the last centroid
+	mPrevCentroids[ i ] = mCentroids[ i ];
+	mCentroids[ i ] = blob.mCentroid;
+	mBboxes[ i ] = blob.mBbox;
+	mAreas[ i ] = blob.mArea;
+	// a coasting track stood still, its velocity is unknown
+	mVelocities[ i ] = ( mStates[ i ] == STATE_ACTIVE ) ?
+		blob.mCentroid - mPrevCentroids[ i ] : Vec2f::zero();
+	mStates[ i ] = STATE_ACTIVE;
+	mMissedFrames[ i ] = 0;
+	mLastSeen[ i ] = time;
+}
+
+Vec2f TrackTable::getPredictedCentroid( size_t i ) const
+{
+	if ( mStates[ i ] == STATE_MERGED )
+		return mCentroids[ i ] + mMergeOffsets[ i ];
+	else
+		return mCentroids[ i ] + mVelocities[ i ];
+}
+
+void TrackTable::merge( size_t i, const Blob &blob, double time )
+{
+	if ( mStates[ i ] != STATE_MERGED )
+		mMergeOffsets[ i ] = mCentroids[ i ] - blob.mCentroid;
+
+	mPrevCentroids[ i ] = mCentroids[ i ];
+	mCentroids[ i ] = blob.mCentroid;
+	mBboxes[ i ] = blob.mBbox;
+	mStates[ i ] = STATE_MERGED;
+	mMissedFrames[ i ] = 0;
+	mLastSeen[ i ] = time;
+}
+
+void TrackTable::miss( size_t i )
+{
+	mStates[ i ] = STATE_COASTING;
+	mVelocities[ i ] = Vec2f::zero();
+	mMissedFrames[ i ]++;
+}
+
+} // namespace mndl
@@ -0,0 +1,408 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iomanip>
+#include <map>
+#include <set>
+
+#include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+#include "cinder/Timer.h"
+
+#include "BlobTracker.h"
+#include "TrackerBenchmark.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+// pens closer than this are detected as one blob
+static const float MERGE_DISTANCE = 0.03f;
+// maximum random offset of the detected position
+static const float JITTER = 0.001f;
+
+vector< TrackerBenchmark::Result > TrackerBenchmark::run( const BlobTracker &config, size_t frames )
+{
+	vector< Result > results;
+	results.push_back( runScenario( config, generateCrossing( frames ) ) );
+	results.push_back( runScenario( config, generateMerges( frames ) ) );
+	results.push_back( runScenario( config, generateSplits( frames ) ) );
+	results.push_back( runScenario( config, generateDropouts( frames ) ) );
+	return results;
+}
+
+void TrackerBenchmark::print( const vector< Result > &results, ostream &out )
+{
+	out << setw( 10 ) << left << "scenario" << right <<
+		setw( 8 ) << "frames" << setw( 10 ) << "ns/frame" <<
+		setw( 6 ) << "pens" << setw( 8 ) << "tracks" <<
+		setw( 8 ) << "id sw" << setw( 8 ) << "frag" <<
+		setw( 8 ) << "false" << setw( 10 ) << "lifetime" << endl;
+
+	for ( vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		out << setw( 10 ) << left << it->mScenario << right <<
+			setw( 8 ) << it->mFrames <<
+			setw( 10 ) << fixed << setprecision( 0 ) << it->mNsPerFrame <<
+			setw( 6 ) << it->mGroundTruthTracks << setw( 8 ) << it->mTracks <<
+			setw( 8 ) << it->mIdSwitches << setw( 8 ) << it->mFragmentations <<
+			setw( 8 ) << it->mFalseTracks <<
+			setw( 10 ) << setprecision( 1 ) << it->mMeanTrackLifetime << endl;
+	}
+}
+
+TrackerBenchmark::Detection TrackerBenchmark::makeDetection( const Vec2f &pos, int32_t gt )
+{
+	Detection d;
+	d.mPos = pos;
+	d.mBbox = Rectf( pos - Vec2f( .01f, .01f ), pos + Vec2f( .01f, .01f ) );
+	d.mArea = .01f * .01f * (float)M_PI;
+	d.mGt[ 0 ] = gt;
+	return d;
+}
+
+TrackerBenchmark::Detection TrackerBenchmark::mergeDetections( const Detection &a, const Detection &b )
+{
+	Detection d;
+	d.mPos = ( a.mPos + b.mPos ) * .5f;
+	d.mBbox = a.mBbox;
+	d.mBbox.include( b.mBbox );
+	d.mArea = a.mArea + b.mArea;
+	d.mGt[ 0 ] = a.mGt[ 0 ];
+	d.mGt[ 1 ] = b.mGt[ 0 ];
+	return d;
+}
+
+//! Two pairs of pens crossing each other's path without touching.
+TrackerBenchmark::Scenario TrackerBenchmark::generateCrossing( size_t frames )
+{
+	Scenario s;
+	s.mName = "crossing";
+	s.mGroundTruthTracks = 4;
+	s.mDetections.resize( frames );
+	s.mPresent.resize( frames );
+
+	Rand rnd( 1 );
+	for ( size_t f = 0; f < frames; f++ )
+	{
+		// triangle wave between 0 and 1 with a period of 2 seconds
+		float t = ( f % 120 ) / 60.f;
+		if ( t > 1.f )
+			t = 2.f - t;
+
+		Vec2f pos[ 4 ];
+		// diagonals, passing the center 0.04 apart
+		pos[ 0 ] = Vec2f( .1f, .1f ) + Vec2f( .8f, .8f ) * t + Vec2f( 0.f, -.02f );
+		pos[ 1 ] = Vec2f( .9f, .1f ) + Vec2f( -.8f, .8f ) * t + Vec2f( 0.f, .02f );
+		// horizontal and vertical, crossing the paths of each other and of
+		// the diagonals at different times, no two pens get closer than 0.08
+		pos[ 2 ] = Vec2f( .3f + .6f * t, .3f );
+		pos[ 3 ] = Vec2f( .6f, .9f - .8f * t );
+
+		for ( int32_t i = 0; i < 4; i++ )
+		{
+			Vec2f jitter( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+			s.mDetections[ f ].push_back( makeDetection( pos[ i ] + jitter, i ) );
+			s.mPresent[ f ].push_back( i );
+		}
+	}
+	return s;
+}
+
+//! Pairs of pens repeatedly approaching until their blobs merge, then separating.
+TrackerBenchmark::Scenario TrackerBenchmark::generateMerges( size_t frames )
+{
+	Scenario s;
+	s.mName = "merges";
+	s.mGroundTruthTracks = 4;
+	s.mDetections.resize( frames );
+	s.mPresent.resize( frames );
+
+	Rand rnd( 2 );
+	for ( size_t f = 0; f < frames; f++ )
+	{
+		for ( int32_t pair = 0; pair < 2; pair++ )
+		{
+			// half distance of the pens oscillates between 0 and .1
+			float phase = f / 60.f * (float)M_PI + pair;
+			float d = .05f + .05f * math< float >::cos( phase );
+			Vec2f center( .3f + .4f * pair, .5f + .1f * math< float >::sin( phase * .5f ) );
+
+			Vec2f jitter0( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+			Vec2f jitter1( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+			int32_t gt0 = 2 * pair;
+			int32_t gt1 = 2 * pair + 1;
+			Detection d0 = makeDetection( center + Vec2f( -d, 0.f ) + jitter0, gt0 );
+			Detection d1 = makeDetection( center + Vec2f( d, 0.f ) + jitter1, gt1 );
+
+			if ( 2.f * d < MERGE_DISTANCE )
+			{
+				s.mDetections[ f ].push_back( mergeDetections( d0, d1 ) );
+			}
+			else
+			{
+				s.mDetections[ f ].push_back( d0 );
+				s.mDetections[ f ].push_back( d1 );
+			}
+			s.mPresent[ f ].push_back( gt0 );
+			s.mPresent[ f ].push_back( gt1 );
+		}
+	}
+	return s;
+}
+
+//! Pairs of pens appearing as one blob and splitting in opposite directions.
+TrackerBenchmark::Scenario TrackerBenchmark::generateSplits( size_t frames )
+{
+	Scenario s;
+	s.mName = "splits";
+	s.mDetections.resize( frames );
+	s.mPresent.resize( frames );
+
+	// a new pair appears every 100 frames and lives for 80 frames
+	const size_t period = 100;
+	const size_t lifetime = 80;
+
+	Rand rnd( 3 );
+	int32_t pairs = 0;
+	Vec2f center, dir;
+	for ( size_t f = 0; f < frames; f++ )
+	{
+		size_t t = f % period;
+		if ( t == 0 )
+		{
+			center = Vec2f( rnd.nextFloat( .2f, .8f ), rnd.nextFloat( .2f, .8f ) );
+			dir = rnd.nextVec2f();
+			pairs++;
+		}
+		if ( t >= lifetime )
+			continue;
+
+		int32_t gt0 = 2 * ( pairs - 1 );
+		int32_t gt1 = gt0 + 1;
+		float d = t * .002f;
+
+		Vec2f jitter0( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+		Vec2f jitter1( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+		Detection d0 = makeDetection( center - dir * d + jitter0, gt0 );
+		Detection d1 = makeDetection( center + dir * d + jitter1, gt1 );
+
+		if ( 2.f * d < MERGE_DISTANCE )
+		{
+			s.mDetections[ f ].push_back( mergeDetections( d0, d1 ) );
+		}
+		else
+		{
+			s.mDetections[ f ].push_back( d0 );
+			s.mDetections[ f ].push_back( d1 );
+		}
+		s.mPresent[ f ].push_back( gt0 );
+		s.mPresent[ f ].push_back( gt1 );
+	}
+	s.mGroundTruthTracks = 2 * pairs;
+	return s;
+}
+
+//! Pens moving on circles with randomly dropped detections.
+TrackerBenchmark::Scenario TrackerBenchmark::generateDropouts( size_t frames )
+{
+	Scenario s;
+	s.mName = "dropouts";
+	s.mGroundTruthTracks = 5;
+	s.mDetections.resize( frames );
+	s.mPresent.resize( frames );
+
+	// remaining frames of a dropout burst by pen
+	int32_t burst[ 5 ] = { 0, 0, 0, 0, 0 };
+
+	Rand rnd( 4 );
+	for ( size_t f = 0; f < frames; f++ )
+	{
+		for ( int32_t i = 0; i < 5; i++ )
+		{
+			float angle = f / 60.f * ( 1.f + .3f * i ) + i;
+			Vec2f pos = Vec2f( .15f + .175f * i, .5f ) +
+				Vec2f( math< float >::cos( angle ), math< float >::sin( angle ) ) * .08f;
+			s.mPresent[ f ].push_back( i );
+
+			// 10% single frame dropouts, 1% three frame bursts
+			float r = rnd.nextFloat();
+			if ( r < .01f )
+				burst[ i ] = 3;
+			if ( burst[ i ] > 0 )
+			{
+				burst[ i ]--;
+				continue;
+			}
+			if ( r < .1f )
+				continue;
+
+			Vec2f jitter( rnd.nextFloat( -JITTER, JITTER ), rnd.nextFloat( -JITTER, JITTER ) );
+			s.mDetections[ f ].push_back( makeDetection( pos + jitter, i ) );
+		}
+	}
+	return s;
+}
+
+TrackerBenchmark::Result TrackerBenchmark::runScenario( const BlobTracker &config, const Scenario &scenario )
+{
+	BlobTracker tracker;
+	tracker.copyTrackingSettings( config );
+
+	const TrackTable &tracks = tracker.mTracks;
+
+	map< int32_t, int32_t > trackGt; // ground truth last associated with the blob id
+	map< int32_t, int32_t > gtTrack; // blob id last tracking the ground truth
+	map< int32_t, int32_t > gtState; // 0: never tracked, 1: tracked, 2: interrupted
+	set< int32_t > gtCovered; // ground truths tracked at least once
+	map< int32_t, size_t > trackBegan; // start frame of living tracks by blob id
+	vector< size_t > lifetimes;
+
+	Result result;
+	result.mScenario = scenario.mName;
+	result.mFrames = scenario.mDetections.size();
+	result.mGroundTruthTracks = scenario.mGroundTruthTracks;
+	result.mTracks = 0;
+	result.mIdSwitches = 0;
+	result.mFragmentations = 0;
+
+	vector< Blob > blobs;
+	blobs.reserve( 64 );
+	Timer timer;
+	double trackingSeconds = 0.;
+
+	for ( size_t f = 0; f < scenario.mDetections.size(); f++ )
+	{
+		const vector< Detection > &detections = scenario.mDetections[ f ];
+
+		blobs.clear();
+		for ( vector< Detection >::const_iterator it = detections.begin(); it != detections.end(); ++it )
+		{
+			Blob b;
+			b.mCentroid = b.mPrevCentroid = it->mPos;
+			b.mBbox = it->mBbox;
+			b.mArea = it->mArea;
+			blobs.push_back( b );
+		}
+
+		timer.start();
+		tracker.trackBlobs( blobs, f / 60. );
+		timer.stop();
+		trackingSeconds += timer.getSeconds();
+
+		// find the ground truth of each track, active tracks are matched
+		// by their position, coasting tracks keep their last ground truth
+		map< int32_t, int32_t > frameGtTrack;
+		set< int32_t > alive;
+		for ( size_t i = 0; i < tracks.size(); i++ )
+		{
+			int32_t id = tracks.getId( i );
+			alive.insert( id );
+			if ( trackBegan.find( id ) == trackBegan.end() )
+			{
+				trackBegan[ id ] = f;
+				result.mTracks++;
+			}
+
+			int32_t gt = -1;
+			map< int32_t, int32_t >::const_iterator lastGt = trackGt.find( id );
+			if ( !tracks.isCoasting( i ) )
+			{
+				for ( vector< Detection >::const_iterator it = detections.begin(); it != detections.end(); ++it )
+				{
+					if ( it->mPos != tracks.getCentroid( i ) )
+						continue;
+
+					gt = it->mGt[ 0 ];
+					if ( ( it->mGt[ 1 ] != -1 ) && ( lastGt != trackGt.end() ) &&
+						 ( lastGt->second == it->mGt[ 1 ] ) )
+						gt = it->mGt[ 1 ];
+					break;
+				}
+			}
+			else
+			if ( lastGt != trackGt.end() )
+			{
+				gt = lastGt->second;
+			}
+
+			if ( gt == -1 )
+				continue;
+
+			trackGt[ id ] = gt;
+			if ( frameGtTrack.find( gt ) == frameGtTrack.end() )
+				frameGtTrack[ gt ] = id;
+		}
+
+		// ended tracks
+		for ( map< int32_t, size_t >::iterator it = trackBegan.begin(); it != trackBegan.end(); )
+		{
+			if ( alive.find( it->first ) == alive.end() )
+			{
+				lifetimes.push_back( f - it->second );
+				trackBegan.erase( it++ );
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		// id switches and fragmentations of the present ground truths
+		const vector< int32_t > &present = scenario.mPresent[ f ];
+		for ( vector< int32_t >::const_iterator git = present.begin(); git != present.end(); ++git )
+		{
+			int32_t gt = *git;
+			map< int32_t, int32_t >::const_iterator tit = frameGtTrack.find( gt );
+			if ( tit != frameGtTrack.end() )
+			{
+				gtCovered.insert( gt );
+
+				map< int32_t, int32_t >::const_iterator lastTrack = gtTrack.find( gt );
+				if ( ( lastTrack != gtTrack.end() ) && ( lastTrack->second != tit->second ) )
+					result.mIdSwitches++;
+				gtTrack[ gt ] = tit->second;
+
+				if ( gtState[ gt ] == 2 )
+					result.mFragmentations++;
+				gtState[ gt ] = 1;
+			}
+			else
+			if ( gtState[ gt ] == 1 )
+			{
+				gtState[ gt ] = 2;
+			}
+		}
+	}
+
+	// tracks still alive at the end
+	for ( map< int32_t, size_t >::const_iterator it = trackBegan.begin(); it != trackBegan.end(); ++it )
+		lifetimes.push_back( result.mFrames - it->second );
+
+	result.mNsPerFrame = result.mFrames ? trackingSeconds * 1e9 / result.mFrames : 0.;
+	result.mFalseTracks = math< int32_t >::max( result.mTracks - (int32_t)gtCovered.size(), 0 );
+
+	size_t lifetimeSum = 0;
+	for ( vector< size_t >::const_iterator it = lifetimes.begin(); it != lifetimes.end(); ++it )
+		lifetimeSum += *it;
+	result.mMeanTrackLifetime = lifetimes.empty() ? 0.f : lifetimeSum / (float)lifetimes.size();
+
+	return result;
+}
+
+} // namespace mndl
@@ -0,0 +1,287 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iomanip>
+
+#include <boost/thread/thread.hpp>
+
+#include "cinder/CinderMath.h"
+#include "cinder/Thread.h"
+#include "cinder/Timer.h"
+
+#include "BlobChannel.h"
+#include "TransportBenchmark.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+// blobs in each generated frame
+static const size_t NUM_BLOBS = 10;
+// local port of the TUIO loopback
+static const int BENCHMARK_PORT = 3339;
+// a frame not received in this many seconds is lost
+static const double RECEIVE_TIMEOUT = 0.1;
+// shared memory object of the channel benchmark
+static const char *BENCHMARK_CHANNEL = "/irpaint-benchmark";
+// latency required from the shared memory channel in microseconds
+static const double CHANNEL_LATENCY_TARGET = 50.;
+
+//! Polls a BlobChannel in its own thread and collects the frames read.
+class ChannelReader
+{
+	public:
+		ChannelReader( BlobChannel *channel, const Timer *timer ) :
+			mChannel( channel ), mTimer( timer ), mRunning( true ),
+			mReceived( 0 ), mLatency( 0. )
+		{}
+
+		void run()
+		{
+			vector< Blob > blobs;
+			double time;
+			while ( isRunning() )
+			{
+				if ( !mChannel->read( &blobs, &time ) )
+				{
+					// lets the writer run on a single core
+					boost::this_thread::yield();
+					continue;
+				}
+				double latency = mTimer->getSeconds() - time;
+
+				std::lock_guard< std::mutex > lock( mMutex );
+				mBlobs.swap( blobs );
+				mLatency += latency;
+				mReceived++;
+			}
+		}
+
+		void stop()
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			mRunning = false;
+		}
+
+		bool isRunning()
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			return mRunning;
+		}
+
+		BlobChannel *mChannel;
+		const Timer *mTimer;
+
+		std::mutex mMutex;
+		bool mRunning;
+		size_t mReceived;
+		double mLatency; //< sum of the latencies of the received frames in seconds
+		vector< Blob > mBlobs; //< last frame read
+};
+
+vector< TransportBenchmark::Result > TransportBenchmark::run( size_t frames )
+{
+	vector< Result > results;
+	results.push_back( runTuio( TuioSender::TUIO_1_1, false, frames ) );
+	results.push_back( runTuio( TuioSender::TUIO_2_0, false, frames ) );
+	results.push_back( runTuio( TuioSender::TUIO_1_1, true, frames ) );
+	results.push_back( runTuio( TuioSender::TUIO_2_0, true, frames ) );
+	results.push_back( runSharedMemory( frames ) );
+	return results;
+}
+
+void TransportBenchmark::print( const vector< Result > &results, ostream &out )
+{
+	out << setw( 18 ) << left << "transport" << right <<
+		setw( 8 ) << "frames" << setw( 10 ) << "received" <<
+		setw( 10 ) << "mismatch" << setw( 10 ) << "us/frame" <<
+		setw( 10 ) << "target" << endl;
+
+	for ( vector< Result >::const_iterator it = results.begin(); it != results.end(); ++it )
+	{
+		out << setw( 18 ) << left << it->mTransport << right <<
+			setw( 8 ) << it->mFrames << setw( 10 ) << it->mReceived <<
+			setw( 10 ) << it->mMismatches <<
+			setw( 10 ) << fixed << setprecision( 1 ) << it->mUsPerFrame;
+		if ( it->mTargetUs <= 0. )
+			out << setw( 10 ) << "-" << endl;
+		else
+			out << setw( 10 ) << ( ( ( it->mReceived == it->mFrames ) &&
+						( it->mUsPerFrame < it->mTargetUs ) ) ? "met" : "missed" ) << endl;
+	}
+}
+
+TransportBenchmark::Result TransportBenchmark::runTuio( TuioSender::Version version, bool restart, size_t frames )
+{
+	Result result;
+	result.mTransport = string( version == TuioSender::TUIO_1_1 ? "tuio 1.1" : "tuio 2.0" ) +
+		( restart ? " restart" : "" );
+	result.mFrames = frames;
+	result.mReceived = 0;
+	result.mMismatches = 0;
+	result.mUsPerFrame = 0.;
+	result.mTargetUs = 0.;
+
+	TuioReceiver receiver;
+	TuioSender sender;
+	if ( !receiver.open( BENCHMARK_PORT ) || !sender.open( "127.0.0.1", BENCHMARK_PORT ) )
+		return result;
+	sender.setVersion( version );
+
+	TrackTable tracks;
+	vector< BlobEvent > events;
+	vector< Blob > blobs;
+	double latency = 0.;
+	for ( size_t i = 0; i < frames; i++ )
+	{
+		if ( restart && ( i == frames / 2 ) )
+		{
+			// the new sender numbers its frames from the beginning
+			sender.close();
+			sender.open( "127.0.0.1", BENCHMARK_PORT );
+			sender.setVersion( version );
+		}
+
+		generateFrame( i, frames, &tracks, &events );
+		BlobFrameEvent frameEvent( &events[ 0 ], i == 0 ? NUM_BLOBS : 0, i == 0 ? 0 : NUM_BLOBS, 0 );
+
+		Timer timer( true );
+		sender.send( tracks, frameEvent, i / 60. );
+		bool received = false;
+		while ( !received && ( timer.getSeconds() < RECEIVE_TIMEOUT ) )
+			received = receiver.popFrame( &blobs );
+		timer.stop();
+		if ( !received )
+			continue;
+
+		latency += timer.getSeconds();
+		result.mReceived++;
+		if ( !matches( tracks, blobs ) )
+			result.mMismatches++;
+	}
+
+	sender.close();
+	receiver.close();
+
+	if ( result.mReceived > 0 )
+		result.mUsPerFrame = latency * 1e6 / result.mReceived;
+	return result;
+}
+
+TransportBenchmark::Result TransportBenchmark::runSharedMemory( size_t frames )
+{
+	Result result;
+	result.mTransport = "shared memory";
+	result.mFrames = frames;
+	result.mReceived = 0;
+	result.mMismatches = 0;
+	result.mUsPerFrame = 0.;
+	result.mTargetUs = CHANNEL_LATENCY_TARGET;
+
+	BlobChannel writer;
+	BlobChannel channel;
+	if ( !writer.openWriter( BENCHMARK_CHANNEL ) || !channel.openReader( BENCHMARK_CHANNEL ) )
+		return result;
+
+	// the frames are stamped with the time of this timer, the reader
+	// thread measures the latency against the same timer
+	Timer timer( true );
+	ChannelReader reader( &channel, &timer );
+	thread readerThread( &ChannelReader::run, &reader );
+
+	TrackTable tracks;
+	vector< BlobEvent > events;
+	for ( size_t i = 0; i < frames; i++ )
+	{
+		generateFrame( i, frames, &tracks, &events );
+		double sent = timer.getSeconds();
+		writer.write( tracks, sent );
+
+		// waits for the reader before writing the next frame
+		bool received = false;
+		while ( !received && ( timer.getSeconds() - sent < RECEIVE_TIMEOUT ) )
+		{
+			{
+				std::lock_guard< std::mutex > lock( reader.mMutex );
+				received = reader.mReceived > result.mReceived;
+				if ( received && !matches( tracks, reader.mBlobs ) )
+					result.mMismatches++;
+			}
+			if ( !received )
+				boost::this_thread::yield();
+		}
+		if ( received )
+			result.mReceived++;
+	}
+
+	reader.stop();
+	readerThread.join();
+	channel.close();
+	writer.close();
+
+	if ( result.mReceived > 0 )
+		result.mUsPerFrame = reader.mLatency * 1e6 / result.mReceived;
+	return result;
+}
+
+void TransportBenchmark::generateFrame( size_t frame, size_t frames, TrackTable *tracks,
+		vector< BlobEvent > *events )
+{
+	events->clear();
+	for ( size_t i = 0; i < NUM_BLOBS; i++ )
+	{
+		// blobs evenly spaced on a circle, going round once in the run
+		float a = 2.f * (float)M_PI * ( (float)i / NUM_BLOBS + (float)frame / frames );
+		Blob b;
+		b.mId = (int32_t)i + 1;
+		b.mCentroid = Vec2f( .5f + .3f * math< float >::cos( a ), .5f + .3f * math< float >::sin( a ) );
+		b.mBbox = Rectf( b.mCentroid - Vec2f( .01f, .01f ), b.mCentroid + Vec2f( .01f, .01f ) );
+		if ( frame == 0 )
+		{
+			b.mPrevCentroid = b.mCentroid;
+			tracks->add( b, frame / 60. );
+			events->push_back( BlobEvent( b, BlobEvent::BLOB_BEGAN ) );
+		}
+		else
+		{
+			b.mPrevCentroid = tracks->getCentroid( i );
+			tracks->update( i, b, frame / 60. );
+			events->push_back( BlobEvent( b, BlobEvent::BLOB_MOVED ) );
+		}
+	}
+}
+
+bool TransportBenchmark::matches( const TrackTable &tracks, const vector< Blob > &blobs )
+{
+	if ( blobs.size() != tracks.size() )
+		return false;
+
+	for ( vector< Blob >::const_iterator it = blobs.begin(); it != blobs.end(); ++it )
+	{
+		bool found = false;
+		for ( size_t i = 0; ( i < tracks.size() ) && !found; i++ )
+			found = ( tracks.getId( i ) == it->mId ) &&
+				( tracks.getCentroid( i ).distanceSquared( it->mCentroid ) < 1e-10f );
+		if ( !found )
+			return false;
+	}
+	return true;
+}
+
+} // namespace mndl
@@ -318,25 +318,79 @@ Vec2<T> TriangleT<T>::calcPoint( const ci::Vec2<T> &origin, T distance, T radian
 	return origin + offset * distance;
 }
 
+// Closest point on triangle from Real-Time Collision Detection by Christer
+// Ericson, 5.1.5. The Voronoi regions of the vertices and the edges are
+// tested in turn, dividing only when the region is found.
+template<typename T> 
+Vec2<T> TriangleT<T>::closestPoint( const TriangleT<T> &triangle, const ci::Vec2<T> &p )
+{
+	const Vec2<T> &a = triangle.mOrigin;
+	const Vec2<T> &b = triangle.mDestination;
+	const Vec2<T> &c = triangle.mApex;
+
+	Vec2<T> ab = b - a;
+	Vec2<T> ac = c - a;
+	Vec2<T> ap = p - a;
+	T d1 = ab.dot( ap );
+	T d2 = ac.dot( ap );
+	if ( d1 <= (T)0 && d2 <= (T)0 ) {
+		return a;
+	}
+
+	Vec2<T> bp = p - b;
+	T d3 = ab.dot( bp );
+	T d4 = ac.dot( bp );
+	if ( d3 >= (T)0 && d4 <= d3 ) {
+		return b;
+	}
+
+	T vc = d1 * d4 - d3 * d2;
+	if ( vc <= (T)0 && d1 >= (T)0 && d3 <= (T)0 ) {
+		T v = d1 / ( d1 - d3 );
+		return a + ab * v;
+	}
+
+	Vec2<T> cp = p - c;
+	T d5 = ab.dot( cp );
+	T d6 = ac.dot( cp );
+	if ( d6 >= (T)0 && d5 <= d6 ) {
+		return c;
+	}
+
+	T vb = d5 * d2 - d1 * d6;
+	if ( vb <= (T)0 && d2 >= (T)0 && d6 <= (T)0 ) {
+		T w = d2 / ( d2 - d6 );
+		return a + ac * w;
+	}
+
+	T va = d3 * d6 - d5 * d4;
+	if ( va <= (T)0 && ( d4 - d3 ) >= (T)0 && ( d5 - d6 ) >= (T)0 ) {
+		T w = ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) );
+		return b + ( c - b ) * w;
+	}
+
+	// inside the triangle, the point is its own closest point. Computing it
+	// back from the barycentric coordinates would only add rounding errors.
+	return p;
+}
+
 template<typename T> 
-Vec2<T> TriangleT<T>::closestPoint( const TriangleT<T> &triangle, const ci::Vec2<T> &p, int32_t n )
+Vec2<T> TriangleT<T>::closestVertex( const TriangleT<T> &triangle, const ci::Vec2<T> &p, int32_t n )
 {
-	Vec2<T> a = triangle.mOrigin;
-	Vec2<T> b = triangle.mDestination;
-	Vec2<T> c = triangle.mApex;
-	T distA = p.distanceSquared( a );
-	T distB = p.distanceSquared( b );
-	T distC = p.distanceSquared( c );
+	Vec2<T> points[ 3 ] = { triangle.mOrigin, triangle.mDestination, triangle.mApex };
+	T dists[ 3 ] = { p.distanceSquared( points[ 0 ] ), p.distanceSquared( points[ 1 ] ),
+		p.distanceSquared( points[ 2 ] ) };
 
-	vector<PointSort> points;
-	points.push_back( PointSort( a, distA ) );
-	points.push_back( PointSort( b, distB ) );
-	points.push_back( PointSort( c, distC ) );
-	sort( points.begin(), points.end() );
+	// insertion sort by distance
+	for ( int32_t i = 1; i < 3; i++ ) {
+		for ( int32_t j = i; j > 0 && dists[ j ] < dists[ j - 1 ]; j-- ) {
+			std::swap( dists[ j ], dists[ j - 1 ] );
+			std::swap( points[ j ], points[ j - 1 ] );
+		}
+	}
 
 	uint32_t index = math<int32_t>::clamp( n, 0, 2 );
-	return points[ index ].mPoint;
-
+	return points[ index ];
 }
 
 template<typename T>
@@ -350,18 +404,13 @@ bool TriangleT<T>::contains( const TriangleT<T> &triangle, const ci::Vec2<T> &p
 template<typename T> 
 T TriangleT<T>::distance( const TriangleT<T> &triangle, const ci::Vec2<T> &p )
 {
-	ci::Vec2<T> i;
-	if ( intersection( triangle, p, &i ) ) {
-		return p.distance( i );
-	}
-	return numeric_limits<T>::max();
+	return math<T>::sqrt( distanceSquared( triangle, p ) );
 }
 
 template<typename T> 
 T TriangleT<T>::distanceSquared( const TriangleT<T> &triangle, const ci::Vec2<T> &p )
 {
-	T dist = distance( triangle, p );
-	return math<T>::pow( dist, 2.0f );
+	return p.distanceSquared( closestPoint( triangle, p ) );
 }
 
 template<typename T> 
@@ -380,8 +429,8 @@ bool TriangleT<T>::intersection( const TriangleT<T> &triangle, const Vec2<T> &p,
 	Vec2<T> point = Vec2<T>::zero();
 	Vec2<T> a1 = p;
 	Vec2<T> b1 = triangle.calcCentroid();
-	Vec2<T> a2 = closestPoint( triangle, p );
-	Vec2<T> b2 = closestPoint( triangle, p, 1 );
+	Vec2<T> a2 = closestVertex( triangle, p );
+	Vec2<T> b2 = closestVertex( triangle, p, 1 );
 	T y1 = b1.y - a1.y;
 	T x1 = b1.x - a1.x;
 	T y2 = b2.y - a2.y;
@@ -857,34 +906,6 @@ Vec2<T> TriangleT<T>::fromBarycentric( const Vec3<T> &p ) const
 	return Vec2<T>( p.x * mOrigin + p.y * mDestination + p.z * mApex );
 }
 
-///////////////////////////////////////////////////////////////////////////////
-template<typename T> 
-TriangleT<T>::PointSort::PointSort( const ci::Vec2<T> &point, T distance )
-{
-	mDistance = distance;
-	mPoint = point;
-}
-
-template<typename T> 
-bool TriangleT<T>::PointSort::operator<( const PointSort &rhs ) const
-{
-	return mDistance < rhs.mDistance;
-}
-
-template<typename T> 
-bool TriangleT<T>::PointSort::operator==( const PointSort &rhs ) const
-{
-	return mDistance == rhs.mDistance && 
-		mPoint.x == rhs.mPoint.x && 
-		mPoint.y == rhs.mPoint.y;
-}
-
-template<typename T> 
-bool TriangleT<T>::PointSort::operator!=( const PointSort &rhs ) const
-{
-	return !( *this == rhs );
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "cinder/gl/gl.h"
@@ -0,0 +1,357 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <limits>
+
+#include "cinder/CinderMath.h"
+
+#include "TriangleBatch.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define MNDL_TRIANGLE_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+template< typename T >
+static inline T edgeDistanceSquared( T px, T py, T ax, T ay, T bx, T by, T invLengthSquared )
+{
+	T ex = bx - ax;
+	T ey = by - ay;
+	T wx = px - ax;
+	T wy = py - ay;
+	T t = math< T >::clamp( ( wx * ex + wy * ey ) * invLengthSquared, 0, 1 );
+	T rx = wx - t * ex;
+	T ry = wy - t * ey;
+	return rx * rx + ry * ry;
+}
+
+template< typename T >
+void TriangleBatch< T >::clear()
+{
+	mSize = 0;
+	mAx.clear(); mAy.clear(); mBx.clear(); mBy.clear(); mCx.clear(); mCy.clear();
+	mInv0.clear(); mInv1.clear(); mInv2.clear(); mInv3.clear();
+	mInvAb.clear(); mInvBc.clear(); mInvCa.clear();
+}
+
+template< typename T >
+void TriangleBatch< T >::reserve( size_t n )
+{
+	n = ( n + BLOCK_SIZE - 1 ) / BLOCK_SIZE * BLOCK_SIZE;
+	mAx.reserve( n ); mAy.reserve( n ); mBx.reserve( n ); mBy.reserve( n ); mCx.reserve( n ); mCy.reserve( n );
+	mInv0.reserve( n ); mInv1.reserve( n ); mInv2.reserve( n ); mInv3.reserve( n );
+	mInvAb.reserve( n ); mInvBc.reserve( n ); mInvCa.reserve( n );
+}
+
+template< typename T >
+void TriangleBatch< T >::push_back( const TriangleT< T > &triangle )
+{
+	if ( mSize % BLOCK_SIZE == 0 )
+	{
+		// start a new block padded with triangles that contain nothing
+		size_t n = mSize + BLOCK_SIZE;
+		T nan = numeric_limits< T >::quiet_NaN();
+		mAx.resize( n, 0 ); mAy.resize( n, 0 ); mBx.resize( n, 0 ); mBy.resize( n, 0 );
+		mCx.resize( n, 0 ); mCy.resize( n, 0 );
+		mInv0.resize( n, nan ); mInv1.resize( n, nan ); mInv2.resize( n, nan ); mInv3.resize( n, nan );
+		mInvAb.resize( n, 0 ); mInvBc.resize( n, 0 ); mInvCa.resize( n, 0 );
+	}
+
+	size_t i = mSize++;
+	const Vec2< T > &a = triangle.a();
+	const Vec2< T > &b = triangle.b();
+	const Vec2< T > &c = triangle.c();
+	mAx[ i ] = a.x;
+	mAy[ i ] = a.y;
+	mBx[ i ] = b.x;
+	mBy[ i ] = b.y;
+	mCx[ i ] = c.x;
+	mCy[ i ] = c.y;
+
+	// same as BarycentricTriangleT, except that degenerate triangles get
+	// the NaN basis of the padding, so the vector tests reject them too
+	T det = ( a.x - c.x ) * ( b.y - c.y ) - ( b.x - c.x ) * ( a.y - c.y );
+	T invDet = ( det != 0 ) ? (T)1 / det : numeric_limits< T >::quiet_NaN();
+	mInv0[ i ] = invDet * ( b.y - c.y );
+	mInv1[ i ] = invDet * ( c.x - b.x );
+	mInv2[ i ] = invDet * ( c.y - a.y );
+	mInv3[ i ] = invDet * ( a.x - c.x );
+
+	T ab = a.distanceSquared( b );
+	T bc = b.distanceSquared( c );
+	T ca = c.distanceSquared( a );
+	mInvAb[ i ] = ( ab > 0 ) ? (T)1 / ab : 0;
+	mInvBc[ i ] = ( bc > 0 ) ? (T)1 / bc : 0;
+	mInvCa[ i ] = ( ca > 0 ) ? (T)1 / ca : 0;
+}
+
+template< typename T >
+TriangleT< T > TriangleBatch< T >::getTriangle( size_t i ) const
+{
+	return TriangleT< T >( Vec2< T >( mAx[ i ], mAy[ i ] ), Vec2< T >( mBx[ i ], mBy[ i ] ),
+			Vec2< T >( mCx[ i ], mCy[ i ] ) );
+}
+
+template< typename T >
+void TriangleBatch< T >::contains( const Vec2< T > &p, uint8_t *result ) const
+{
+	uint8_t block[ BLOCK_SIZE ];
+	for ( size_t i = 0; i < mSize; i += BLOCK_SIZE )
+	{
+		if ( i + BLOCK_SIZE <= mSize )
+		{
+			containsBlock( i, p, result + i );
+		}
+		else
+		{
+			containsBlock( i, p, block );
+			copy( block, block + mSize - i, result + i );
+		}
+	}
+}
+
+template< typename T >
+void TriangleBatch< T >::toBarycentric( const Vec2< T > &p, Vec3< T > *result ) const
+{
+	T l1[ BLOCK_SIZE ];
+	T l2[ BLOCK_SIZE ];
+	for ( size_t i = 0; i < mSize; i += BLOCK_SIZE )
+	{
+		toBarycentricBlock( i, p, l1, l2 );
+		size_t n = math< size_t >::min( BLOCK_SIZE, mSize - i );
+		for ( size_t j = 0; j < n; j++ )
+			result[ i + j ] = Vec3< T >( l1[ j ], l2[ j ], 1 - l1[ j ] - l2[ j ] );
+	}
+}
+
+template< typename T >
+void TriangleBatch< T >::distanceSquared( const Vec2< T > &p, T *result ) const
+{
+	T block[ BLOCK_SIZE ];
+	for ( size_t i = 0; i < mSize; i += BLOCK_SIZE )
+	{
+		if ( i + BLOCK_SIZE <= mSize )
+		{
+			distanceSquaredBlock( i, p, result + i );
+		}
+		else
+		{
+			distanceSquaredBlock( i, p, block );
+			copy( block, block + mSize - i, result + i );
+		}
+	}
+}
+
+template< typename T >
+int32_t TriangleBatch< T >::findContaining( const Vec2< T > &p ) const
+{
+	// padding triangles contain nothing, whole blocks can be tested
+	uint8_t block[ BLOCK_SIZE ];
+	for ( size_t i = 0; i < mSize; i += BLOCK_SIZE )
+	{
+		containsBlock( i, p, block );
+		for ( size_t j = 0; j < BLOCK_SIZE; j++ )
+		{
+			if ( block[ j ] )
+				return (int32_t)( i + j );
+		}
+	}
+	return -1;
+}
+
+template< typename T >
+int32_t TriangleBatch< T >::findClosest( const Vec2< T > &p, T *distanceSquared ) const
+{
+	T block[ BLOCK_SIZE ];
+	T closestDistance = numeric_limits< T >::max();
+	int32_t closest = -1;
+	for ( size_t i = 0; i < mSize; i += BLOCK_SIZE )
+	{
+		distanceSquaredBlock( i, p, block );
+		size_t n = math< size_t >::min( BLOCK_SIZE, mSize - i );
+		for ( size_t j = 0; j < n; j++ )
+		{
+			if ( block[ j ] < closestDistance )
+			{
+				closestDistance = block[ j ];
+				closest = (int32_t)( i + j );
+			}
+		}
+	}
+
+	if ( distanceSquared != NULL )
+		*distanceSquared = closestDistance;
+	return closest;
+}
+
+template< typename T >
+void TriangleBatch< T >::containsBlock( size_t i, const Vec2< T > &p, uint8_t *result ) const
+{
+	T l1[ BLOCK_SIZE ];
+	T l2[ BLOCK_SIZE ];
+	toBarycentricBlock( i, p, l1, l2 );
+	for ( size_t j = 0; j < BLOCK_SIZE; j++ )
+		result[ j ] = ( 0 <= l1[ j ] ) && ( 0 <= l2[ j ] ) && ( l1[ j ] + l2[ j ] <= 1 );
+}
+
+template< typename T >
+void TriangleBatch< T >::toBarycentricBlock( size_t i, const Vec2< T > &p, T *l1, T *l2 ) const
+{
+	for ( size_t j = 0, k = i; j < BLOCK_SIZE; j++, k++ )
+	{
+		T dx = p.x - mCx[ k ];
+		T dy = p.y - mCy[ k ];
+		l1[ j ] = mInv0[ k ] * dx + mInv1[ k ] * dy;
+		l2[ j ] = mInv2[ k ] * dx + mInv3[ k ] * dy;
+	}
+}
+
+template< typename T >
+void TriangleBatch< T >::distanceSquaredBlock( size_t i, const Vec2< T > &p, T *result ) const
+{
+	T l1[ BLOCK_SIZE ];
+	T l2[ BLOCK_SIZE ];
+	toBarycentricBlock( i, p, l1, l2 );
+	for ( size_t j = 0, k = i; j < BLOCK_SIZE; j++, k++ )
+	{
+		if ( ( 0 <= l1[ j ] ) && ( 0 <= l2[ j ] ) && ( l1[ j ] + l2[ j ] <= 1 ) )
+		{
+			result[ j ] = 0;
+			continue;
+		}
+
+		T d = edgeDistanceSquared( p.x, p.y, mAx[ k ], mAy[ k ], mBx[ k ], mBy[ k ], mInvAb[ k ] );
+		d = math< T >::min( d, edgeDistanceSquared( p.x, p.y, mBx[ k ], mBy[ k ], mCx[ k ], mCy[ k ], mInvBc[ k ] ) );
+		d = math< T >::min( d, edgeDistanceSquared( p.x, p.y, mCx[ k ], mCy[ k ], mAx[ k ], mAy[ k ], mInvCa[ k ] ) );
+		result[ j ] = d;
+	}
+}
+
+#if defined( MNDL_TRIANGLE_BATCH_SSE2 )
+
+// thin wrappers of the SSE2 intrinsics
+typedef __m128 vfloat;
+static const size_t SIMD_WIDTH = 4;
+static inline vfloat vload( const float *p ) { return _mm_loadu_ps( p ); }
+static inline void vstore( float *p, vfloat a ) { _mm_storeu_ps( p, a ); }
+static inline vfloat vset( float a ) { return _mm_set1_ps( a ); }
+static inline vfloat vadd( vfloat a, vfloat b ) { return _mm_add_ps( a, b ); }
+static inline vfloat vsub( vfloat a, vfloat b ) { return _mm_sub_ps( a, b ); }
+static inline vfloat vmul( vfloat a, vfloat b ) { return _mm_mul_ps( a, b ); }
+static inline vfloat vmin( vfloat a, vfloat b ) { return _mm_min_ps( a, b ); }
+static inline vfloat vmax( vfloat a, vfloat b ) { return _mm_max_ps( a, b ); }
+static inline vfloat vand( vfloat a, vfloat b ) { return _mm_and_ps( a, b ); }
+static inline vfloat vle( vfloat a, vfloat b ) { return _mm_cmple_ps( a, b ); }
+//! Returns \a a where \a mask is set, \a b elsewhere
+static inline vfloat vselect( vfloat mask, vfloat a, vfloat b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+static inline int vmovemask( vfloat a ) { return _mm_movemask_ps( a ); }
+
+static inline vfloat vedgeDistanceSquared( vfloat px, vfloat py, vfloat ax, vfloat ay, vfloat bx, vfloat by,
+		vfloat invLengthSquared )
+{
+	vfloat ex = vsub( bx, ax );
+	vfloat ey = vsub( by, ay );
+	vfloat wx = vsub( px, ax );
+	vfloat wy = vsub( py, ay );
+	vfloat t = vmul( vadd( vmul( wx, ex ), vmul( wy, ey ) ), invLengthSquared );
+	t = vmin( vmax( t, vset( 0.f ) ), vset( 1.f ) );
+	vfloat rx = vsub( wx, vmul( t, ex ) );
+	vfloat ry = vsub( wy, vmul( t, ey ) );
+	return vadd( vmul( rx, rx ), vmul( ry, ry ) );
+}
+
+//! Inside mask of the barycentric coordinates, the same test as TriangleT::contains
+static inline vfloat vinside( vfloat l1, vfloat l2 )
+{
+	vfloat zero = vset( 0.f );
+	return vand( vand( vle( zero, l1 ), vle( zero, l2 ) ), vle( vadd( l1, l2 ), vset( 1.f ) ) );
+}
+
+template<>
+void TriangleBatch< float >::toBarycentricBlock( size_t i, const Vec2f &p, float *l1, float *l2 ) const
+{
+	vfloat px = vset( p.x );
+	vfloat py = vset( p.y );
+	for ( size_t j = 0; j < BLOCK_SIZE; j += SIMD_WIDTH )
+	{
+		size_t k = i + j;
+		vfloat dx = vsub( px, vload( &mCx[ k ] ) );
+		vfloat dy = vsub( py, vload( &mCy[ k ] ) );
+		vstore( l1 + j, vadd( vmul( vload( &mInv0[ k ] ), dx ), vmul( vload( &mInv1[ k ] ), dy ) ) );
+		vstore( l2 + j, vadd( vmul( vload( &mInv2[ k ] ), dx ), vmul( vload( &mInv3[ k ] ), dy ) ) );
+	}
+}
+
+template<>
+void TriangleBatch< float >::containsBlock( size_t i, const Vec2f &p, uint8_t *result ) const
+{
+	vfloat px = vset( p.x );
+	vfloat py = vset( p.y );
+	for ( size_t j = 0; j < BLOCK_SIZE; j += SIMD_WIDTH )
+	{
+		size_t k = i + j;
+		vfloat dx = vsub( px, vload( &mCx[ k ] ) );
+		vfloat dy = vsub( py, vload( &mCy[ k ] ) );
+		vfloat l1 = vadd( vmul( vload( &mInv0[ k ] ), dx ), vmul( vload( &mInv1[ k ] ), dy ) );
+		vfloat l2 = vadd( vmul( vload( &mInv2[ k ] ), dx ), vmul( vload( &mInv3[ k ] ), dy ) );
+		int bits = vmovemask( vinside( l1, l2 ) );
+		for ( size_t m = 0; m < SIMD_WIDTH; m++ )
+			result[ j + m ] = ( bits >> m ) & 1;
+	}
+}
+
+template<>
+void TriangleBatch< float >::distanceSquaredBlock( size_t i, const Vec2f &p, float *result ) const
+{
+	vfloat px = vset( p.x );
+	vfloat py = vset( p.y );
+	for ( size_t j = 0; j < BLOCK_SIZE; j += SIMD_WIDTH )
+	{
+		size_t k = i + j;
+		vfloat ax = vload( &mAx[ k ] );
+		vfloat ay = vload( &mAy[ k ] );
+		vfloat bx = vload( &mBx[ k ] );
+		vfloat by = vload( &mBy[ k ] );
+		vfloat cx = vload( &mCx[ k ] );
+		vfloat cy = vload( &mCy[ k ] );
+
+		vfloat dx = vsub( px, cx );
+		vfloat dy = vsub( py, cy );
+		vfloat l1 = vadd( vmul( vload( &mInv0[ k ] ), dx ), vmul( vload( &mInv1[ k ] ), dy ) );
+		vfloat l2 = vadd( vmul( vload( &mInv2[ k ] ), dx ), vmul( vload( &mInv3[ k ] ), dy ) );
+
+		vfloat d = vedgeDistanceSquared( px, py, ax, ay, bx, by, vload( &mInvAb[ k ] ) );
+		d = vmin( d, vedgeDistanceSquared( px, py, bx, by, cx, cy, vload( &mInvBc[ k ] ) ) );
+		d = vmin( d, vedgeDistanceSquared( px, py, cx, cy, ax, ay, vload( &mInvCa[ k ] ) ) );
+		vstore( result + j, vselect( vinside( l1, l2 ), vset( 0.f ), d ) );
+	}
+}
+
+#endif
+
+template class TriangleBatch< float >;
+template class TriangleBatch< double >;
+
+} // namespace mndl
@@ -0,0 +1,196 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <float.h>
+
+#include <algorithm>
+
+#include "cinder/CinderMath.h"
+
+#include "TriangleLocator.h"
+
+using namespace ci;
+using namespace std;
+
+namespace mndl {
+
+// number of steps to walk before searching the buckets
+static const int MAX_WALK_STEPS = 4;
+
+void TriangleLocator::setup( const vector< BarycentricTrianglef > &triangles, const Vec2i &gridSize )
+{
+	mTriangles = triangles;
+	mGridSize = gridSize;
+	mLastHit = -1;
+
+	mBucketStart.clear();
+	mBucketTriangles.clear();
+	if ( mTriangles.empty() )
+		return;
+
+	mBounds = mTriangles[ 0 ].calcBoundingBox();
+	for ( vector< BarycentricTrianglef >::const_iterator it = mTriangles.begin(); it != mTriangles.end(); ++it )
+		mBounds.include( it->calcBoundingBox() );
+
+	// about one grid cell per bucket
+	mBucketCount = Vec2i( math< int >::max( 1, mGridSize.x - 1 ),
+						  math< int >::max( 1, mGridSize.y - 1 ) );
+	mBucketScale = Vec2f( mBucketCount.x / math< float >::max( mBounds.getWidth(), FLT_EPSILON ),
+						  mBucketCount.y / math< float >::max( mBounds.getHeight(), FLT_EPSILON ) );
+
+	vector< vector< int32_t > > buckets( mBucketCount.x * mBucketCount.y );
+	for ( size_t i = 0; i < mTriangles.size(); i++ )
+	{
+		Rectf bbox = mTriangles[ i ].calcBoundingBox();
+		Vec2i ul = getBucket( bbox.getUpperLeft() );
+		Vec2i lr = getBucket( bbox.getLowerRight() );
+		for ( int y = ul.y; y <= lr.y; y++ )
+			for ( int x = ul.x; x <= lr.x; x++ )
+				buckets[ x + y * mBucketCount.x ].push_back( i );
+	}
+
+	mBucketStart.reserve( buckets.size() + 1 );
+	for ( size_t i = 0; i < buckets.size(); i++ )
+	{
+		mBucketStart.push_back( mBucketTriangles.size() );
+		mBucketTriangles.insert( mBucketTriangles.end(), buckets[ i ].begin(), buckets[ i ].end() );
+	}
+	mBucketStart.push_back( mBucketTriangles.size() );
+
+	// triangles of the border edges clockwise from the top left corner
+	mBorder.clear();
+	mBorderTriangles.clear();
+	int32_t cellsX = mGridSize.x - 1;
+	int32_t cellsY = mGridSize.y - 1;
+	for ( int32_t x = 0; x < cellsX; x++ )
+		addBorderTriangle( 2 * x + 1 );
+	for ( int32_t y = 0; y < cellsY; y++ )
+		addBorderTriangle( 2 * ( cellsX - 1 + y * cellsX ) + 1 );
+	for ( int32_t x = cellsX - 1; x >= 0; x-- )
+		addBorderTriangle( 2 * ( x + ( cellsY - 1 ) * cellsX ) );
+	for ( int32_t y = cellsY - 1; y >= 0; y-- )
+		addBorderTriangle( 2 * y * cellsX );
+}
+
+void TriangleLocator::addBorderTriangle( int32_t triangle )
+{
+	// corner triangles have two border edges
+	if ( find( mBorderTriangles.begin(), mBorderTriangles.end(), triangle ) != mBorderTriangles.end() )
+		return;
+
+	mBorder.push_back( mTriangles[ triangle ].getTriangle() );
+	mBorderTriangles.push_back( triangle );
+}
+
+int32_t TriangleLocator::locate( const Vec2f &p )
+{
+	if ( mTriangles.empty() )
+		return -1;
+
+	int32_t t = -1;
+	if ( mLastHit >= 0 )
+		t = walk( mLastHit, p );
+	if ( t < 0 )
+		t = searchBuckets( p );
+
+	if ( t >= 0 )
+		mLastHit = t;
+	return t;
+}
+
+int32_t TriangleLocator::locateClosest( const Vec2f &p )
+{
+	int32_t t = locate( p );
+	if ( ( t >= 0 ) || mTriangles.empty() )
+		return t;
+
+	// the closest triangle to a point outside of the grid is a triangle
+	// on the border of the grid
+	int32_t closest = mBorder.findClosest( p );
+	return ( closest < 0 ) ? -1 : mBorderTriangles[ closest ];
+}
+
+int32_t TriangleLocator::walk( int32_t triangle, const Vec2f &p ) const
+{
+	int32_t cellsX = mGridSize.x - 1;
+	int32_t cellsY = mGridSize.y - 1;
+
+	for ( int i = 0; i < MAX_WALK_STEPS; i++ )
+	{
+		const BarycentricTrianglef &t = mTriangles[ triangle ];
+		Vec3f bary = t.toBarycentric( p );
+		if ( !t.isDegenerate() && ( bary.x >= 0.f ) && ( bary.y >= 0.f ) && ( bary.x + bary.y <= 1.f ) )
+			return triangle;
+
+		// cross the edge opposite to the vertex with the most negative weight
+		int vertex = 0;
+		if ( bary.y < bary.x )
+			vertex = 1;
+		if ( bary.z < bary[ vertex ] )
+			vertex = 2;
+
+		// triangle 0 of a cell is top-left, bottom-left, bottom-right,
+		// triangle 1 is top-left, bottom-right, top-right
+		int32_t cell = triangle / 2;
+		int32_t x = cell % cellsX;
+		int32_t y = cell / cellsX;
+		if ( ( triangle & 1 ) == 0 )
+		{
+			if ( vertex == 0 )
+				y++;
+			else
+			if ( vertex == 2 )
+				x--;
+		}
+		else
+		{
+			if ( vertex == 0 )
+				x++;
+			else
+			if ( vertex == 1 )
+				y--;
+		}
+		if ( ( x < 0 ) || ( x >= cellsX ) || ( y < 0 ) || ( y >= cellsY ) )
+			return -1;
+		triangle = 2 * ( x + y * cellsX ) + ( ( triangle & 1 ) ^ 1 );
+	}
+	return -1;
+}
+
+int32_t TriangleLocator::searchBuckets( const Vec2f &p ) const
+{
+	if ( !mBounds.contains( p ) )
+		return -1;
+
+	Vec2i bucket = getBucket( p );
+	int32_t b = bucket.x + bucket.y * mBucketCount.x;
+	for ( int32_t i = mBucketStart[ b ]; i < mBucketStart[ b + 1 ]; i++ )
+	{
+		int32_t t = mBucketTriangles[ i ];
+		if ( mTriangles[ t ].contains( p ) )
+			return t;
+	}
+	return -1;
+}
+
+Vec2i TriangleLocator::getBucket( const Vec2f &p ) const
+{
+	return Vec2i( math< int >::clamp( (int)( ( p.x - mBounds.x1 ) * mBucketScale.x ), 0, mBucketCount.x - 1 ),
+				  math< int >::clamp( (int)( ( p.y - mBounds.y1 ) * mBucketScale.y ), 0, mBucketCount.y - 1 ) );
+}
+
+} // namespace mndl
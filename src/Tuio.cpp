@@ -0,0 +1,792 @@
+/*
+ Copyright (C) 2012 Gabor Papp
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "cinder/app/App.h"
+#include "cinder/Thread.h"
+
+#include "Tuio.h"
+
+using namespace ci;
+using namespace std;
+using boost::asio::ip::udp;
+
+namespace mndl {
+
+// maximum payload of an UDP datagram
+static const size_t MAX_PACKET_SIZE = 65507;
+// half size of the bounding box of received TUIO 1.1 cursors, which have no size
+static const float CURSOR_RADIUS = .01f;
+// fseq numbers older than this are out of order, otherwise the sender restarted
+static const int32_t MAX_FSEQ_REORDER = 100;
+// the frame numbering restarts after this many milliseconds without packets
+static const int64_t FSEQ_TIMEOUT_MS = 1000;
+
+//! Writes OSC bundles into a fixed size buffer
+class OscWriter
+{
+	public:
+		OscWriter( char *buffer, size_t capacity ) :
+			mBuffer( buffer ), mCapacity( capacity ), mSize( 0 ), mOverflow( false ),
+			mMessageStart( 0 )
+		{}
+
+		size_t getSize() const { return mSize; }
+		//! Returns true if the buffer was too small for the bundle
+		bool hasOverflow() const { return mOverflow; }
+
+		void beginBundle( uint64_t timeTag )
+		{
+			writeString( "#bundle" );
+			writeUInt64( timeTag );
+		}
+
+		/** Starts a bundle element with the message \a address. The type tags are
+		 *  \a typeTags followed by \a numInts int32 tags. **/
+		void beginMessage( const char *address, const char *typeTags, size_t numInts = 0 )
+		{
+			mMessageStart = mSize;
+			writeInt32( 0 ); // element size, filled in by endMessage
+			writeString( address );
+
+			size_t tagsLength = 1 + strlen( typeTags ) + numInts;
+			if ( !reserve( pad( tagsLength + 1 ) ) )
+				return;
+			char *tags = mBuffer + mSize;
+			*tags++ = ',';
+			tags = copy( typeTags, typeTags + strlen( typeTags ), tags );
+			fill( tags, tags + numInts, 'i' );
+			fill( mBuffer + mSize + tagsLength, mBuffer + mSize + pad( tagsLength + 1 ), '\0' );
+			mSize += pad( tagsLength + 1 );
+		}
+
+		void endMessage()
+		{
+			if ( mOverflow )
+				return;
+			writeBigEndian( mBuffer + mMessageStart, (uint32_t)( mSize - mMessageStart - 4 ) );
+		}
+
+		void writeInt32( int32_t v )
+		{
+			if ( reserve( 4 ) )
+			{
+				writeBigEndian( mBuffer + mSize, (uint32_t)v );
+				mSize += 4;
+			}
+		}
+
+		void writeFloat( float v )
+		{
+			uint32_t u;
+			memcpy( &u, &v, 4 );
+			if ( reserve( 4 ) )
+			{
+				writeBigEndian( mBuffer + mSize, u );
+				mSize += 4;
+			}
+		}
+
+		void writeUInt64( uint64_t v )
+		{
+			writeInt32( (int32_t)( v >> 32 ) );
+			writeInt32( (int32_t)( v & 0xffffffff ) );
+		}
+
+		void writeString( const char *s )
+		{
+			size_t length = strlen( s );
+			if ( !reserve( pad( length + 1 ) ) )
+				return;
+			copy( s, s + length, mBuffer + mSize );
+			fill( mBuffer + mSize + length, mBuffer + mSize + pad( length + 1 ), '\0' );
+			mSize += pad( length + 1 );
+		}
+
+	private:
+		static size_t pad( size_t n ) { return ( n + 3 ) & ~3; }
+
+		static void writeBigEndian( char *dst, uint32_t v )
+		{
+			dst[ 0 ] = (char)( v >> 24 );
+			dst[ 1 ] = (char)( v >> 16 );
+			dst[ 2 ] = (char)( v >> 8 );
+			dst[ 3 ] = (char)v;
+		}
+
+		bool reserve( size_t n )
+		{
+			if ( mSize + n > mCapacity )
+				mOverflow = true;
+			return !mOverflow;
+		}
+
+		char *mBuffer;
+		size_t mCapacity;
+		size_t mSize;
+		bool mOverflow;
+		size_t mMessageStart;
+};
+
+//! Reads the arguments of an OSC message
+class OscReader
+{
+	public:
+		OscReader( const char *data, size_t size ) :
+			mData( data ), mSize( size ), mPos( 0 ), mError( false )
+		{}
+
+		bool hasError() const { return mError; }
+		bool atEnd() const { return mError || ( mPos >= mSize ); }
+		//! Returns true if a bundle starts at the current position
+		bool isBundle() const { return ( mPos + 8 <= mSize ) && ( memcmp( mData + mPos, "#bundle", 8 ) == 0 ); }
+
+		int32_t readInt32()
+		{
+			if ( !check( 4 ) )
+				return 0;
+			const unsigned char *p = reinterpret_cast< const unsigned char * >( mData + mPos );
+			mPos += 4;
+			return (int32_t)( ( (uint32_t)p[ 0 ] << 24 ) | ( (uint32_t)p[ 1 ] << 16 ) |
+							  ( (uint32_t)p[ 2 ] << 8 ) | p[ 3 ] );
+		}
+
+		float readFloat()
+		{
+			uint32_t u = (uint32_t)readInt32();
+			float v;
+			memcpy( &v, &u, 4 );
+			return v;
+		}
+
+		const char *readString()
+		{
+			const char *s = mData + mPos;
+			const char *end = (const char *)memchr( s, '\0', mSize - mPos );
+			if ( end == NULL )
+			{
+				mError = true;
+				return "";
+			}
+			mPos += ( end - s + 4 ) & ~3;
+			return s;
+		}
+
+		//! Returns a reader of the next \a size bytes
+		OscReader readBlock( size_t size )
+		{
+			if ( !check( size ) )
+				return OscReader( mData, 0 );
+			OscReader block( mData + mPos, size );
+			mPos += size;
+			return block;
+		}
+
+	private:
+		bool check( size_t n )
+		{
+			if ( mPos + n > mSize )
+				mError = true;
+			return !mError;
+		}
+
+		const char *mData;
+		size_t mSize;
+		size_t mPos;
+		bool mError;
+};
+
+//! Returns the current time as OSC time tag
+static uint64_t getOscTime()
+{
+	using namespace boost::posix_time;
+	using namespace boost::gregorian;
+
+	time_duration sinceEpoch = microsec_clock::universal_time() - ptime( date( 1900, Jan, 1 ) );
+	uint64_t seconds = (uint64_t)sinceEpoch.total_seconds();
+	uint64_t micros = (uint64_t)( sinceEpoch.total_microseconds() % 1000000 );
+	return ( seconds << 32 ) | ( ( micros << 32 ) / 1000000 );
+}
+
+//! OSC bundle time tag meaning immediately
+static const uint64_t OSC_IMMEDIATELY = 1;
+
+//
+// TuioSender
+//
+
+struct TuioSender::Obj
+{
+	Obj() : mPort( 0 ), mVersion( TUIO_1_1 ), mWidth( 0 ), mHeight( 0 ),
+		mFrameId( 0 ), mLastTime( 0. ), mSocket( mIoService )
+	{
+		mBuffer.resize( MAX_PACKET_SIZE );
+		mAlive.reserve( 64 );
+	}
+
+	void appendTuio1( OscWriter &osc, const BlobFrameEvent &event, float dt );
+	void appendTuio2( OscWriter &osc, const BlobFrameEvent &event, float dt );
+
+	std::string mHost;
+	int mPort;
+	Version mVersion;
+	int mWidth, mHeight;
+	std::string mSource; //< source name, user@address
+
+	int32_t mFrameId;
+	double mLastTime;
+	std::vector< int32_t > mAlive; //< ids of the tracks alive in the current frame
+	std::vector< char > mBuffer; //< preallocated bundle buffer
+
+	boost::asio::io_service mIoService;
+	udp::socket mSocket;
+	udp::endpoint mEndpoint;
+};
+
+bool TuioSender::open( const std::string &host, int port )
+{
+	if ( !mObj )
+		mObj = std::shared_ptr< Obj >( new Obj() );
+
+	boost::system::error_code ec;
+	mObj->mSocket.close( ec );
+	mObj->mHost = host;
+	mObj->mPort = port;
+	mObj->mFrameId = 0;
+
+	try
+	{
+		udp::resolver resolver( mObj->mIoService );
+		udp::resolver::query query( udp::v4(), host, boost::lexical_cast< std::string >( port ) );
+		mObj->mEndpoint = *resolver.resolve( query );
+		mObj->mSocket.open( udp::v4() );
+		mObj->mSource = "IRPaint@" + boost::asio::ip::host_name();
+	}
+	catch ( const std::exception &exc )
+	{
+		app::console() << "Unable to open TUIO output to " << host << ":" << port <<
+			" " << exc.what() << endl;
+		mObj->mSocket.close( ec );
+		mObj->mHost.clear();
+		mObj->mPort = 0;
+		return false;
+	}
+	return true;
+}
+
+void TuioSender::close()
+{
+	if ( !mObj )
+		return;
+
+	boost::system::error_code ec;
+	mObj->mSocket.close( ec );
+	mObj.reset();
+}
+
+bool TuioSender::isOpen() const
+{
+	return mObj && mObj->mSocket.is_open();
+}
+
+const std::string & TuioSender::getHost() const
+{
+	static const std::string empty;
+	return mObj ? mObj->mHost : empty;
+}
+
+int TuioSender::getPort() const
+{
+	return mObj ? mObj->mPort : 0;
+}
+
+void TuioSender::setVersion( Version version )
+{
+	if ( !mObj )
+		mObj = std::shared_ptr< Obj >( new Obj() );
+	mObj->mVersion = version;
+}
+
+void TuioSender::setDimension( int width, int height )
+{
+	if ( !mObj )
+		mObj = std::shared_ptr< Obj >( new Obj() );
+	mObj->mWidth = width;
+	mObj->mHeight = height;
+}
+
+void TuioSender::send( const TrackTable &tracks, const BlobFrameEvent &event, double now )
+{
+	if ( !isOpen() )
+		return;
+
+	// the alive list is rebuilt from the tracks every frame, so it can not
+	// drift from the tracker even if an event is missed
+	mObj->mAlive.resize( tracks.size() );
+	for ( size_t i = 0; i < tracks.size(); i++ )
+		mObj->mAlive[ i ] = tracks.getId( i );
+
+	float dt = ( mObj->mLastTime > 0. ) ? (float)( now - mObj->mLastTime ) : 0.f;
+	mObj->mLastTime = now;
+	mObj->mFrameId++;
+
+	OscWriter osc( &mObj->mBuffer[ 0 ], mObj->mBuffer.size() );
+	osc.beginBundle( OSC_IMMEDIATELY );
+	if ( mObj->mVersion == TUIO_1_1 )
+		mObj->appendTuio1( osc, event, dt );
+	else
+		mObj->appendTuio2( osc, event, dt );
+
+	if ( osc.hasOverflow() )
+	{
+		app::console() << "TUIO bundle does not fit into an UDP packet" << endl;
+		return;
+	}
+
+	boost::system::error_code ec;
+	mObj->mSocket.send_to( boost::asio::buffer( &mObj->mBuffer[ 0 ], osc.getSize() ),
+			mObj->mEndpoint, 0, ec );
+}
+
+//! Returns the velocity of the event blob in normalized units per second
+static Vec2f getVelocity( const BlobEvent &e, float dt )
+{
+	if ( ( dt <= 0.f ) || ( e.getType() != BlobEvent::BLOB_MOVED ) )
+		return Vec2f::zero();
+	return ( e.getPos() - e.getPrevPos() ) / dt;
+}
+
+void TuioSender::Obj::appendTuio1( OscWriter &osc, const BlobFrameEvent &event, float dt )
+{
+	osc.beginMessage( "/tuio/2Dcur", "ss" );
+	osc.writeString( "source" );
+	osc.writeString( mSource.c_str() );
+	osc.endMessage();
+
+	osc.beginMessage( "/tuio/2Dcur", "s", mAlive.size() );
+	osc.writeString( "alive" );
+	for ( vector< int32_t >::const_iterator it = mAlive.begin(); it != mAlive.end(); ++it )
+		osc.writeInt32( *it );
+	osc.endMessage();
+
+	// set messages of the began and moved blobs, which are stored first
+	BlobEventRange events = event.getEvents();
+	size_t numChanged = event.getBegan().size() + event.getMoved().size();
+	for ( size_t i = 0; i < numChanged; i++ )
+	{
+		const BlobEvent &e = events[ i ];
+		Vec2f vel = getVelocity( e, dt );
+		osc.beginMessage( "/tuio/2Dcur", "sifffff" );
+		osc.writeString( "set" );
+		osc.writeInt32( e.getId() );
+		osc.writeFloat( e.getX() );
+		osc.writeFloat( e.getY() );
+		osc.writeFloat( vel.x );
+		osc.writeFloat( vel.y );
+		osc.writeFloat( 0.f ); // motion acceleration is not tracked
+		osc.endMessage();
+	}
+
+	osc.beginMessage( "/tuio/2Dcur", "si" );
+	osc.writeString( "fseq" );
+	osc.writeInt32( mFrameId );
+	osc.endMessage();
+}
+
+void TuioSender::Obj::appendTuio2( OscWriter &osc, const BlobFrameEvent &event, float dt )
+{
+	osc.beginMessage( "/tuio2/frm", "itis" );
+	osc.writeInt32( mFrameId );
+	osc.writeUInt64( getOscTime() );
+	osc.writeInt32( ( mWidth << 16 ) | ( mHeight & 0xffff ) );
+	osc.writeString( mSource.c_str() );
+	osc.endMessage();
+
+	BlobEventRange events = event.getEvents();
+	size_t numChanged = event.getBegan().size() + event.getMoved().size();
+	for ( size_t i = 0; i < numChanged; i++ )
+	{
+		const BlobEvent &e = events[ i ];
+		Vec2f vel = getVelocity( e, dt );
+		const Rectf &bbox = e.getBoundingBox();
+		float radius = .25f * ( bbox.getWidth() + bbox.getHeight() );
+
+		// s_id tu_id c_id x y angle shear radius press x_vel y_vel p_vel m_acc p_acc
+		osc.beginMessage( "/tuio2/ptr", "iiifffffffffff" );
+		osc.writeInt32( e.getId() );
+		osc.writeInt32( 0 ); // unknown pointer type and user
+		osc.writeInt32( 0 );
+		osc.writeFloat( e.getX() );
+		osc.writeFloat( e.getY() );
+		osc.writeFloat( 0.f );
+		osc.writeFloat( 0.f );
+		osc.writeFloat( radius );
+		osc.writeFloat( 1.f );
+		osc.writeFloat( vel.x );
+		osc.writeFloat( vel.y );
+		osc.writeFloat( 0.f );
+		osc.writeFloat( 0.f );
+		osc.writeFloat( 0.f );
+		osc.endMessage();
+	}
+
+	osc.beginMessage( "/tuio2/alv", "", mAlive.size() );
+	for ( vector< int32_t >::const_iterator it = mAlive.begin(); it != mAlive.end(); ++it )
+		osc.writeInt32( *it );
+	osc.endMessage();
+}
+
+//
+// TuioReceiver
+//
+
+struct TuioReceiver::Obj
+{
+	Obj() : mPort( 0 ), mLastFrameId( -1 ), mFrameValid( true ), mPendingAlive( false ),
+		mSocket( mIoService )
+	{
+		mBuffer.resize( MAX_PACKET_SIZE );
+	}
+
+	void run() { mIoService.run(); }
+	void startReceive();
+	void handleReceive( const boost::system::error_code &error, size_t size );
+
+	void parseBundle( OscReader &reader );
+	void parseMessage( OscReader &reader );
+	void parseTuio1( OscReader &reader, const char *tags );
+	void parseTuio2Frame( OscReader &reader, const char *tags );
+	void parseTuio2Pointer( OscReader &reader, const char *tags );
+	void readAlive( OscReader &reader, const char *tags, std::vector< int32_t > *alive );
+
+	bool isNewFrame( int32_t frameId ) const;
+	void finishFrame();
+
+	int mPort;
+
+	// receiver thread state
+	int32_t mLastFrameId;
+	bool mFrameValid;
+	std::vector< int32_t > mAlive;
+	std::map< int32_t, Blob > mBlobs; //< last state of the blobs by id
+
+	// TUIO 1.1 frames are numbered by the fseq message at the end of the
+	// bundle, alive and set messages wait here until it is checked
+	bool mPendingAlive;
+	std::vector< int32_t > mPendingAliveIds;
+	std::vector< Blob > mPendingBlobs;
+
+	std::vector< char > mBuffer;
+	boost::asio::io_service mIoService;
+	udp::socket mSocket;
+	udp::endpoint mSenderEndpoint;
+	udp::endpoint mLastSenderEndpoint; //< source of the frames numbered by \a mLastFrameId
+	boost::posix_time::ptime mLastReceiveTime;
+	std::shared_ptr< std::thread > mThread;
+
+	std::mutex mMutex;
+	std::deque< std::vector< Blob > > mFrames; //< received frames waiting for the main thread
+};
+
+bool TuioReceiver::open( int port )
+{
+	close();
+	mObj = std::shared_ptr< Obj >( new Obj() );
+
+	try
+	{
+		mObj->mSocket.open( udp::v4() );
+		mObj->mSocket.bind( udp::endpoint( udp::v4(), port ) );
+	}
+	catch ( const std::exception &exc )
+	{
+		app::console() << "Unable to listen to TUIO on port " << port << " " << exc.what() << endl;
+		// the port is not reported, so opening is retried
+		mObj.reset();
+		return false;
+	}
+	mObj->mPort = port;
+
+	mObj->startReceive();
+	mObj->mThread = std::shared_ptr< std::thread >( new std::thread(
+				boost::bind( &TuioReceiver::Obj::run, mObj.get() ) ) );
+	return true;
+}
+
+void TuioReceiver::close()
+{
+	if ( !mObj )
+		return;
+
+	mObj->mIoService.stop();
+	if ( mObj->mThread )
+	{
+		mObj->mThread->join();
+		mObj->mThread.reset();
+	}
+	boost::system::error_code ec;
+	mObj->mSocket.close( ec );
+	mObj.reset();
+}
+
+bool TuioReceiver::isOpen() const
+{
+	return mObj && mObj->mSocket.is_open();
+}
+
+int TuioReceiver::getPort() const
+{
+	return mObj ? mObj->mPort : 0;
+}
+
+bool TuioReceiver::popFrame( std::vector< Blob > *blobs )
+{
+	if ( !mObj )
+		return false;
+
+	std::lock_guard< std::mutex > lock( mObj->mMutex );
+	if ( mObj->mFrames.empty() )
+		return false;
+
+	blobs->swap( mObj->mFrames.front() );
+	mObj->mFrames.pop_front();
+	return true;
+}
+
+void TuioReceiver::Obj::startReceive()
+{
+	mSocket.async_receive_from( boost::asio::buffer( &mBuffer[ 0 ], mBuffer.size() ), mSenderEndpoint,
+			boost::bind( &TuioReceiver::Obj::handleReceive, this,
+				boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred ) );
+}
+
+void TuioReceiver::Obj::handleReceive( const boost::system::error_code &error, size_t size )
+{
+	if ( error == boost::asio::error::operation_aborted )
+		return;
+
+	if ( !error )
+	{
+		// a different or restarted sender numbers its frames from the beginning
+		boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+		if ( ( mSenderEndpoint != mLastSenderEndpoint ) || mLastReceiveTime.is_not_a_date_time() ||
+			 ( ( now - mLastReceiveTime ).total_milliseconds() > FSEQ_TIMEOUT_MS ) )
+			mLastFrameId = -1;
+		mLastSenderEndpoint = mSenderEndpoint;
+		mLastReceiveTime = now;
+
+		// TUIO 1.1 messages of a packet without fseq are dropped
+		mPendingAlive = false;
+		mPendingBlobs.clear();
+
+		OscReader reader( &mBuffer[ 0 ], size );
+		if ( reader.isBundle() )
+			parseBundle( reader );
+		else
+			parseMessage( reader );
+	}
+
+	startReceive();
+}
+
+void TuioReceiver::Obj::parseBundle( OscReader &reader )
+{
+	reader.readString(); // #bundle
+	reader.readInt32(); // time tag
+	reader.readInt32();
+
+	while ( !reader.atEnd() )
+	{
+		int32_t size = reader.readInt32();
+		OscReader element = reader.readBlock( (size_t)max( size, 0 ) );
+		if ( reader.hasError() )
+			return;
+
+		if ( element.isBundle() )
+			parseBundle( element );
+		else
+			parseMessage( element );
+	}
+}
+
+void TuioReceiver::Obj::parseMessage( OscReader &reader )
+{
+	const char *address = reader.readString();
+	const char *tags = reader.readString();
+	if ( reader.hasError() || ( tags[ 0 ] != ',' ) )
+		return;
+	tags++;
+
+	if ( strcmp( address, "/tuio/2Dcur" ) == 0 )
+		parseTuio1( reader, tags );
+	else
+	if ( strcmp( address, "/tuio2/frm" ) == 0 )
+		parseTuio2Frame( reader, tags );
+	else
+	if ( strcmp( address, "/tuio2/ptr" ) == 0 )
+		parseTuio2Pointer( reader, tags );
+	else
+	if ( strcmp( address, "/tuio2/alv" ) == 0 )
+	{
+		// alv ends the TUIO 2.0 frame
+		if ( mFrameValid )
+		{
+			readAlive( reader, tags, &mAlive );
+			finishFrame();
+		}
+	}
+}
+
+void TuioReceiver::Obj::parseTuio1( OscReader &reader, const char *tags )
+{
+	if ( tags[ 0 ] != 's' )
+		return;
+	const char *command = reader.readString();
+
+	if ( strcmp( command, "alive" ) == 0 )
+	{
+		readAlive( reader, tags + 1, &mPendingAliveIds );
+		mPendingAlive = true;
+	}
+	else
+	if ( strcmp( command, "set" ) == 0 )
+	{
+		if ( strncmp( tags + 1, "iff", 3 ) != 0 )
+			return;
+		int32_t id = reader.readInt32();
+		Vec2f pos;
+		pos.x = reader.readFloat();
+		pos.y = reader.readFloat();
+
+		Blob b;
+		b.mId = id;
+		b.mCentroid = pos;
+		b.mBbox = Rectf( pos - Vec2f( CURSOR_RADIUS, CURSOR_RADIUS ),
+						 pos + Vec2f( CURSOR_RADIUS, CURSOR_RADIUS ) );
+		mPendingBlobs.push_back( b );
+	}
+	else
+	if ( strcmp( command, "fseq" ) == 0 )
+	{
+		if ( tags[ 1 ] != 'i' )
+			return;
+		// fseq ends the TUIO 1.1 frame, the pending messages of a late
+		// frame are dropped
+		int32_t frameId = reader.readInt32();
+		if ( isNewFrame( frameId ) )
+		{
+			if ( frameId != -1 )
+				mLastFrameId = frameId;
+			for ( vector< Blob >::const_iterator it = mPendingBlobs.begin(); it != mPendingBlobs.end(); ++it )
+				mBlobs[ it->mId ] = *it;
+			if ( mPendingAlive )
+				mAlive.swap( mPendingAliveIds );
+			finishFrame();
+		}
+		mPendingAlive = false;
+		mPendingBlobs.clear();
+	}
+}
+
+void TuioReceiver::Obj::parseTuio2Frame( OscReader &reader, const char *tags )
+{
+	if ( tags[ 0 ] != 'i' )
+		return;
+
+	int32_t frameId = reader.readInt32();
+	mFrameValid = isNewFrame( frameId );
+	if ( mFrameValid )
+		mLastFrameId = frameId;
+}
+
+void TuioReceiver::Obj::parseTuio2Pointer( OscReader &reader, const char *tags )
+{
+	// the velocities and accelerations are optional
+	if ( !mFrameValid || ( ( strcmp( tags, "iiiffffff" ) != 0 ) &&
+						   ( strcmp( tags, "iiifffffffffff" ) != 0 ) ) )
+		return;
+
+	int32_t id = reader.readInt32();
+	reader.readInt32(); // tu_id
+	reader.readInt32(); // c_id
+	Vec2f pos;
+	pos.x = reader.readFloat();
+	pos.y = reader.readFloat();
+	reader.readFloat(); // angle
+	reader.readFloat(); // shear
+	float radius = reader.readFloat();
+	if ( radius <= 0.f )
+		radius = CURSOR_RADIUS;
+
+	Blob &b = mBlobs[ id ];
+	b.mId = id;
+	b.mCentroid = pos;
+	b.mBbox = Rectf( pos - Vec2f( radius, radius ), pos + Vec2f( radius, radius ) );
+}
+
+void TuioReceiver::Obj::readAlive( OscReader &reader, const char *tags, vector< int32_t > *alive )
+{
+	alive->clear();
+	for ( ; *tags == 'i'; tags++ )
+		alive->push_back( reader.readInt32() );
+}
+
+bool TuioReceiver::Obj::isNewFrame( int32_t frameId ) const
+{
+	// -1 marks redundant frames that are always processed
+	if ( ( frameId == -1 ) || ( mLastFrameId == -1 ) )
+		return true;
+	return ( frameId > mLastFrameId ) || ( mLastFrameId - frameId > MAX_FSEQ_REORDER );
+}
+
+void TuioReceiver::Obj::finishFrame()
+{
+	vector< Blob > frame;
+	frame.reserve( mAlive.size() );
+	for ( vector< int32_t >::const_iterator it = mAlive.begin(); it != mAlive.end(); ++it )
+	{
+		map< int32_t, Blob >::iterator blobIt = mBlobs.find( *it );
+		if ( blobIt == mBlobs.end() )
+			continue;
+		frame.push_back( blobIt->second );
+	}
+
+	// forget the blobs not alive
+	for ( map< int32_t, Blob >::iterator it = mBlobs.begin(); it != mBlobs.end(); )
+	{
+		if ( find( mAlive.begin(), mAlive.end(), it->first ) == mAlive.end() )
+			mBlobs.erase( it++ );
+		else
+			++it;
+	}
+
+	std::lock_guard< std::mutex > lock( mMutex );
+	mFrames.push_back( vector< Blob >() );
+	mFrames.back().swap( frame );
+}
+
+} // namespace mndl